@@ -0,0 +1,71 @@
+#include "ActuatorControl.h"
+
+#include "SensorPipeline.h"
+
+ActuatorControl::ActuatorControl(WaveformEngine& engine)
+    : engine(engine), textureVoice(-1), lastContactId(0)
+{
+}
+
+void ActuatorControl::start()
+{
+    stop();
+    lastContactId = 0;     // Tracker IDs restart with a new session
+
+    // Held until stopped; silent while nothing is pressed since texture
+    // voices scale with pressure
+    WavePattern texture = {};
+    texture.shape = WAVE_TEXTURE;
+    texture.channelMask = 0xFF;
+    texture.amplitude = TEXTURE_AMPLITUDE;
+    texture.frequency = TEXTURE_FREQUENCY;
+    texture.duration = 0.0f;
+    texture.envelope.attack = 0.0f;
+    texture.envelope.decay = 0.0f;
+    texture.envelope.sustain = 1.0f;
+    texture.envelope.release = 0.05f;
+    textureVoice = engine.play(texture);
+}
+
+void ActuatorControl::stop()
+{
+    if (textureVoice >= 0) engine.release(textureVoice);
+    textureVoice = -1;
+}
+
+uint8_t ActuatorControl::update(const Contact* contacts, int count, float scalingFactor, float offsetValue)
+{
+    // Drive the actuators from the highest contact peak
+    float force = 0.0f;
+    bool newContact = false;
+    for (int i = 0; i < count; ++i) {
+        if (contacts[i].peak > force) force = contacts[i].peak;
+        // IDs only grow, so anything above the last one seen is new
+        if (contacts[i].id > lastContactId) {
+            lastContactId = contacts[i].id;
+            newContact = true;
+        }
+    }
+
+    uint8_t levels[FLUID_CHANNELS];
+    uint8_t scaledLevel = mapForceToActuator(force, scalingFactor, offsetValue);
+    for (uint8_t& level : levels) {
+        level = scaledLevel;
+    }
+    engine.setBaseLevels(levels);
+    engine.setPressure(force / PRESSURE_MAX);
+
+    if (newContact) {
+        WavePattern tap = {};
+        tap.shape = WAVE_CONSTANT;
+        tap.channelMask = 0xFF;
+        tap.amplitude = TAP_AMPLITUDE;
+        tap.duration = TAP_DECAY;
+        tap.envelope.attack = 0.0f;
+        tap.envelope.decay = TAP_DECAY;
+        tap.envelope.sustain = 0.0f;
+        tap.envelope.release = 0.0f;
+        engine.play(tap);
+    }
+    return scaledLevel;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ContactTracker.h"
+#include "WaveformEngine.h"
+
+#define CONTROL_LOOP_PERIOD_MS 100    // How often the GUI loop updates the actuators
+#define TEXTURE_AMPLITUDE 30.0f       // Texture level on top of the base level at full pressure
+#define TEXTURE_FREQUENCY 40.0f       // Texture scan rate (Hz) at full pressure
+#define TAP_AMPLITUDE 60.0f           // Short pulse played when a new contact appears
+#define TAP_DECAY 0.03f               // Seconds the tap takes to fade out
+
+// Turns the contacts of the latest frame into actuator commands. The
+// highest peak sets the base level (the original force mapping), pressure
+// drives a held texture voice, and each newly tracked contact plays a tap.
+class ActuatorControl {
+public:
+    explicit ActuatorControl(WaveformEngine& engine);
+
+    // Start and stop the held texture voice
+    void start();
+    void stop();
+
+    // Apply one control step, returns the base level sent to every channel
+    uint8_t update(const Contact* contacts, int count, float scalingFactor, float offsetValue);
+
+private:
+    WaveformEngine& engine;
+    int textureVoice;
+    int lastContactId;      // Highest contact ID already tapped
+};
@@ -0,0 +1,155 @@
+#include "ContactTracker.h"
+
+#include <algorithm>
+
+ContactTracker::ContactTracker(int width, int height, float threshold, float maxMatchDistance, int maxContacts)
+    : width(width), height(height),
+      // Region sums (and so centroids) and the peak search rely on every
+      // member taxel being strictly positive
+      threshold(threshold > CONTACT_THRESHOLD_MIN ? threshold : CONTACT_THRESHOLD_MIN),
+      maxMatchDistanceSq(maxMatchDistance * maxMatchDistance), maxContacts(maxContacts),
+      labels(width * height, -1), fillStack(width * height, 0),
+      current(maxContacts), previous(maxContacts),
+      previousTaken(maxContacts, 0), currentTaken(maxContacts, 0),
+      numCurrent(0), numPrevious(0), nextId(1)
+{
+}
+
+void ContactTracker::reset()
+{
+    numCurrent = 0;
+    numPrevious = 0;
+    nextId = 1;
+}
+
+const Contact* ContactTracker::strongest() const
+{
+    const Contact* best = nullptr;
+    for (int i = 0; i < numCurrent; ++i) {
+        if (!best || current[i].totalForce > best->totalForce) {
+            best = &current[i];
+        }
+    }
+    return best;
+}
+
+int ContactTracker::update(const float* frame, const float* tare)
+{
+    // Last frame's contacts become the match candidates for this frame
+    std::swap(current, previous);
+    numPrevious = numCurrent;
+    numCurrent = 0;
+
+    std::fill(labels.begin(), labels.end(), -1);
+
+    for (int i = 0; i < width * height; ++i) {
+        if (labels[i] != -1) continue;
+        float value = tare ? frame[i] - tare[i] : frame[i];
+        // Written so NaN (a corrupt or non-finite reading) is never labelled
+        if (!(value >= threshold)) continue;
+
+        // Regions past the capacity are still flooded (so they are visited
+        // once) under the overflow label, but are not reported
+        int label = numCurrent < maxContacts ? numCurrent : maxContacts;
+        labelRegion(i, label, frame, tare);
+    }
+
+    matchContacts();
+    return numCurrent;
+}
+
+void ContactTracker::labelRegion(int seed, int label, const float* frame, const float* tare)
+{
+    float sumForce = 0.0f;
+    float sumX = 0.0f;
+    float sumY = 0.0f;
+    float peak = 0.0f;
+    int peakIndex = seed;
+    int area = 0;
+
+    int top = 0;
+    fillStack[top++] = seed;
+    labels[seed] = label;
+
+    while (top > 0) {
+        int index = fillStack[--top];
+        int x = index % width;
+        int y = index / width;
+        float value = tare ? frame[index] - tare[index] : frame[index];
+
+        sumForce += value;
+        sumX += value * x;
+        sumY += value * y;
+        ++area;
+        if (value > peak) {
+            peak = value;
+            peakIndex = index;
+        }
+
+        // 4-connected neighbours, each taxel is pushed at most once
+        const int neighbours[4][2] = { { x - 1, y }, { x + 1, y }, { x, y - 1 }, { x, y + 1 } };
+        for (const auto& n : neighbours) {
+            if (n[0] < 0 || n[0] >= width || n[1] < 0 || n[1] >= height) continue;
+            int next = n[1] * width + n[0];
+            if (labels[next] != -1) continue;
+            float nextValue = tare ? frame[next] - tare[next] : frame[next];
+            if (!(nextValue >= threshold)) continue;
+            labels[next] = label;
+            fillStack[top++] = next;
+        }
+    }
+
+    if (label >= maxContacts) return;
+
+    Contact& c = current[numCurrent++];
+    c.id = 0;
+    c.age = 0;
+    c.area = area;
+    c.centroidX = sumX / sumForce;
+    c.centroidY = sumY / sumForce;
+    c.totalForce = sumForce;
+    c.peak = peak;
+    c.peakIndex = peakIndex;
+}
+
+void ContactTracker::matchContacts()
+{
+    std::fill(previousTaken.begin(), previousTaken.end(), 0);
+    std::fill(currentTaken.begin(), currentTaken.end(), 0);
+
+    // Greedy nearest-pair matching; contact counts are small so the
+    // quadratic scan per match is cheaper than sorting candidate pairs
+    while (true) {
+        int bestPrev = -1;
+        int bestCur = -1;
+        float bestDistSq = maxMatchDistanceSq;
+        for (int p = 0; p < numPrevious; ++p) {
+            if (previousTaken[p]) continue;
+            for (int c = 0; c < numCurrent; ++c) {
+                if (currentTaken[c]) continue;
+                float dx = previous[p].centroidX - current[c].centroidX;
+                float dy = previous[p].centroidY - current[c].centroidY;
+                float distSq = dx * dx + dy * dy;
+                if (distSq <= bestDistSq) {
+                    bestDistSq = distSq;
+                    bestPrev = p;
+                    bestCur = c;
+                }
+            }
+        }
+        if (bestPrev < 0) break;
+
+        previousTaken[bestPrev] = 1;
+        currentTaken[bestCur] = 1;
+        current[bestCur].id = previous[bestPrev].id;
+        current[bestCur].age = previous[bestPrev].age + 1;
+    }
+
+    // Anything left unmatched is a new contact
+    for (int c = 0; c < numCurrent; ++c) {
+        if (!currentTaken[c]) {
+            current[c].id = nextId++;
+            current[c].age = 1;
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+
+#define CONTACT_MAX_DEFAULT 32
+#define CONTACT_THRESHOLD_MIN 1e-3f    // Thresholds are clamped to at least this
+
+struct Contact {
+    int id;             // Stable for as long as the contact is tracked
+    int age;            // Number of frames this contact has been tracked
+    int area;           // Number of taxels in the region
+    float centroidX;    // Force weighted, in taxel coordinates
+    float centroidY;
+    float totalForce;   // Sum of tared values over the region
+    float peak;         // Largest tared value in the region
+    int peakIndex;      // Taxel index of the peak
+};
+
+// Per-frame contact analysis: splits a tared frame into connected regions
+// above a threshold and keeps their IDs stable from one frame to the next.
+// All storage is allocated up front, update() never allocates.
+class ContactTracker {
+public:
+    ContactTracker(int width, int height, float threshold, float maxMatchDistance,
+        int maxContacts = CONTACT_MAX_DEFAULT);
+
+    // Analyse one frame (width * height values, row major). tare may be null.
+    // Returns the number of contacts found.
+    int update(const float* frame, const float* tare);
+
+    // Forget all tracked contacts, the next update starts fresh IDs
+    void reset();
+
+    int count() const { return numCurrent; }
+    const Contact* contacts() const { return current.data(); }
+
+    // Contact with the largest total force, or null when there is none
+    const Contact* strongest() const;
+
+private:
+    void labelRegion(int seed, int label, const float* frame, const float* tare);
+    void matchContacts();
+
+    int width;
+    int height;
+    float threshold;
+    float maxMatchDistanceSq;
+    int maxContacts;
+
+    std::vector<int> labels;        // Region per taxel, -1 below threshold
+    std::vector<int> fillStack;     // Flood fill work list
+    std::vector<Contact> current;
+    std::vector<Contact> previous;
+    std::vector<char> previousTaken;
+    std::vector<char> currentTaken;
+    int numCurrent;
+    int numPrevious;
+    int nextId;
+};
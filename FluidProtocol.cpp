@@ -0,0 +1,14 @@
+#include "FluidProtocol.h"
+
+#include <string.h>
+
+static const uint8_t vibrationHeader[] = { 0xaa, 0xac, 0x00 };
+static const uint8_t packetTrailer[] = { 0xcc, 0x88, 0xc8, 0x8c };
+
+size_t encodeVibrationPacket(const uint8_t levels[FLUID_CHANNELS], uint8_t* out)
+{
+	memcpy(out, vibrationHeader, sizeof(vibrationHeader));
+	memcpy(out + sizeof(vibrationHeader), levels, FLUID_CHANNELS);
+	memcpy(out + sizeof(vibrationHeader) + FLUID_CHANNELS, packetTrailer, sizeof(packetTrailer));
+	return FLUID_VIBRATION_PACKET_SIZE;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Wire format of the FluidReality driver commands, kept free of any
+// platform code so it can be used off-device.
+
+#define FLUID_CHANNELS 8
+#define FLUID_VIBRATION_PACKET_SIZE (3 + FLUID_CHANNELS + 4)
+
+// Build the 0xaa 0xac ("weVibin") packet for one set of channel levels.
+// out must hold FLUID_VIBRATION_PACKET_SIZE bytes; returns the packet length.
+size_t encodeVibrationPacket(const uint8_t levels[FLUID_CHANNELS], uint8_t* out);
@@ -7,6 +7,7 @@
 #include <conio.h>
 
 #include "FluidReality.h"
+#include "FluidProtocol.h"
 
 
 
@@ -19,6 +20,8 @@ uint16_t fluidSerialPortNr = 0;
 
 const char driverOrder[NUM_DRIVERS] = { 0 };
 
+#define FLUID_ERROR_REPORT_INTERVAL 500		// About once a second when streaming at 500 Hz
+
 
 bool scan_ports(wchar_t* outComPort, size_t outSize, char* vid, char* pid)
 {
@@ -247,3 +250,21 @@ int setFluidValues(char values[8])
 	return 0;
 }
 
+int sendFluidFrame(const uint8_t levels[8])
+{
+	static unsigned long failedFrames = 0;
+	uint8_t packet[FLUID_VIBRATION_PACKET_SIZE];
+	DWORD length = static_cast<DWORD>(encodeVibrationPacket(levels, packet));
+	DWORD bytesWritten;
+
+	if (!WriteFile(fluidSerialHandle, packet, length, &bytesWritten, NULL) || bytesWritten != length) {
+		// Called hundreds of times a second, so only the first failure of a
+		// run and then every FLUID_ERROR_REPORT_INTERVAL-th one is printed
+		if (failedFrames++ % FLUID_ERROR_REPORT_INTERVAL == 0) {
+			printf("Error writing to COM port: %lu (%lu frame(s) failed)\n", GetLastError(), failedFrames);
+		}
+		return -1;
+	}
+	failedFrames = 0;
+	return 0;
+}
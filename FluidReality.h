@@ -1,11 +1,18 @@
 #pragma once
 
+#include <stdint.h>
+
 int initFluidReality();
 
 void exitFluidReality();
 
 int setFluidValues(char values[8]);
 
+// Send one vibration packet in a single write. Meant for streaming at a
+// high rate, see WaveformEngine: nothing is printed on success, and write
+// failures are reported only occasionally rather than once per call.
+int sendFluidFrame(const uint8_t levels[8]);
+
 int EnablePSU();
 
 int DisablePSU();
@@ -0,0 +1,726 @@
+// Headless benchmark of the sensing-to-actuation pipeline.
+//
+// Runs each stage on synthetic data through the same modules the
+// visualizer uses, then the whole loop end to end against emulated sensor
+// and driver ports (pseudo-terminals, POSIX only), including the control
+// loop cadence and the waveform engine. Results go to stdout as JSON, a
+// readable summary to stderr. With --thresholds the run fails when a
+// metric is outside its limit or was not reported.
+//
+// Usage: PipelineBenchmark [--json FILE] [--thresholds FILE] [--quick]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SensorPipeline.h"
+#include "ContactTracker.h"
+#include "SensorClock.h"
+#include "FluidProtocol.h"
+#include "WaveformEngine.h"
+#include "ActuatorControl.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#if defined(__APPLE__)
+#include <util.h>
+#else
+#include <pty.h>
+#endif
+#endif
+
+#define RENDER_CELL_SIZE 100       // Same cell size the window uses
+#define PRINT_QUEUE_MAX 4096       // Same bound as the visualizer's print queue
+#define E2E_TIMEOUT_MS 1000
+#define E2E_SENSOR_RATE_HZ 1000    // Emulated sensor sample rate
+#define E2E_IDLE_FRAMES 300        // Untouched frames around the touches
+#define E2E_TOUCH_FRAMES 150       // Touches and gaps last 1 - 2x this many frames
+#define E2E_TOUCH_FORCE 2500.0f    // What makeSensorLine adds to a touched taxel
+#define E2E_STALL_MS 100           // Host stall the reader takes in the final idle frames
+
+typedef std::chrono::steady_clock Clock;
+
+struct Metric {
+    std::string name;
+    double value;
+    std::string unit;
+};
+
+static std::vector<Metric> metrics;
+// Keeps the optimizer from dropping work. Each bench and thread sums into a
+// local sink and adds it here once, so no thread races on a shared counter.
+static std::atomic<uint64_t> checksum(0);
+
+static void consume(uint64_t sink)
+{
+    checksum.fetch_add(sink, std::memory_order_relaxed);
+}
+
+static void report(const std::string& name, double value, const char* unit)
+{
+    metrics.push_back({ name, value, unit });
+    fprintf(stderr, "  %-32s %14.1f %s\n", name.c_str(), value, unit);
+}
+
+static double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static double percentile(std::vector<double> samples, double fraction)
+{
+    if (samples.empty()) return 0.0;
+    std::sort(samples.begin(), samples.end());
+    size_t index = static_cast<size_t>(fraction * (samples.size() - 1) + 0.5);
+    return samples[index];
+}
+
+// A frame as the firmware prints it: taxels around the tare with noise and,
+// when touched, a contact wandering over the grid, optionally followed by a
+// counter
+static std::string makeSensorLine(uint32_t& seed, int frame, bool withCounter, bool touched)
+{
+    char line[256];
+    int length = 0;
+    int pressed = (frame / 50) % SENSOR_TAXELS;
+    for (int i = 0; i < SENSOR_TAXELS; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        float value = 1000.0f + (seed >> 24) / 25.6f;
+        if (touched && i == pressed) value += 2500.0f;
+        length += snprintf(line + length, sizeof(line) - length, i ? ",%.2f" : "%.2f", value);
+    }
+    if (withCounter) length += snprintf(line + length, sizeof(line) - length, ",%d", frame);
+    snprintf(line + length, sizeof(line) - length, "\r\n");
+    return line;
+}
+
+// Frame of any grid size with two blobs moving in opposite directions
+static void makeGridFrame(int size, int frame, float* out)
+{
+    float ax = (frame % 200) / 200.0f * size;
+    float bx = size - ax;
+    float ay = size * 0.3f;
+    float by = size * 0.7f;
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            float da = (x - ax) * (x - ax) + (y - ay) * (y - ay);
+            float db = (x - bx) * (x - bx) + (y - by) * (y - by);
+            float value = 3000.0f / (1.0f + da) + 2000.0f / (1.0f + db);
+            out[y * size + x] = value;
+        }
+    }
+}
+
+static void benchCsvParse(int numLines)
+{
+    uint32_t seed = 1;
+    std::string data;
+    for (int i = 0; i < numLines; ++i) data += makeSensorLine(seed, i, false, true);
+
+    int repeats = 0;
+    uint64_t frames = 0;
+    uint64_t sink = 0;
+    Clock::time_point start = Clock::now();
+    do {
+        const char* pos = data.c_str();
+        const char* end = pos + data.size();
+        while (pos < end) {
+            const char* newline = static_cast<const char*>(memchr(pos, '\n', end - pos));
+            float values[SENSOR_TAXELS + 1];
+            if (parseSensorLine(pos, newline, ',', values, SENSOR_TAXELS + 1, nullptr) == SENSOR_TAXELS) {
+                ++frames;
+                sink += static_cast<uint64_t>(values[0]);
+            }
+            pos = newline + 1;
+        }
+        ++repeats;
+    } while (secondsSince(start) < 0.3);
+    double seconds = secondsSince(start);
+    consume(sink);
+
+    report("csv_parse_mb_per_s", data.size() * repeats / 1048576.0 / seconds, "MB/s");
+    report("csv_parse_frames_per_s", frames / seconds, "frames/s");
+}
+
+// The reader queues every frame for the log under printMutex, then
+// publishes under frameMutex, as in the visualizer. The GUI thread runs the
+// control step under frameMutex; the print thread only takes printMutex to
+// swap the queue out and formats outside it.
+static void benchFramePublish(int numFrames)
+{
+    struct LoggedFrame {
+        float values[SENSOR_TAXELS];
+        FrameTiming timing;
+    };
+
+    std::mutex frameMutex;
+    std::vector<float> latestFrame(SENSOR_TAXELS, 0.0f);
+    std::vector<float> tareValues(SENSOR_TAXELS, 1000.0f);
+    std::vector<Contact> latestContacts;
+    latestContacts.reserve(CONTACT_MAX_DEFAULT);
+    ContactTracker tracker(SENSOR_GRID_SIZE, SENSOR_GRID_SIZE, CONTACT_THRESHOLD, CONTACT_MATCH_DISTANCE);
+    std::mutex printMutex;
+    std::vector<LoggedFrame> printQueue;
+    printQueue.reserve(PRINT_QUEUE_MAX);
+    uint64_t unloggedFrames = 0;
+    WaveformEngine engine;
+    ActuatorControl control(engine);
+    std::atomic<bool> done(false);
+
+    std::thread gui([&]() {
+        control.start();
+        uint64_t sink = 0;
+        while (!done) {
+            {
+                std::lock_guard<std::mutex> lock(frameMutex);
+                sink += control.update(latestContacts.data(), static_cast<int>(latestContacts.size()),
+                    SCALING_DEFAULT, OFFSET_DEFAULT);
+            }
+            std::this_thread::yield();
+        }
+        control.stop();
+        consume(sink);
+    });
+    std::thread printer([&]() {
+        std::vector<LoggedFrame> frames;
+        frames.reserve(PRINT_QUEUE_MAX);
+        uint64_t sink = 0;
+        while (!done) {
+            {
+                std::lock_guard<std::mutex> lock(printMutex);
+                frames.swap(printQueue);
+                sink += unloggedFrames;
+                unloggedFrames = 0;
+            }
+            for (const LoggedFrame& frame : frames) {
+                sink += static_cast<uint64_t>(frame.values[0]) + static_cast<uint64_t>(frame.timing.sampleIndex);
+            }
+            frames.clear();
+            std::this_thread::yield();
+        }
+        consume(sink);
+    });
+
+    uint32_t seed = 7;
+    std::vector<std::vector<float>> frames(256, std::vector<float>(SENSOR_TAXELS));
+    for (int f = 0; f < 256; ++f) {
+        std::string line = makeSensorLine(seed, f, false, true);
+        parseSensorLine(line.data(), line.data() + line.size(), ',', frames[f].data(), SENSOR_TAXELS, nullptr);
+    }
+
+    std::vector<double> publishUs;
+    publishUs.reserve(numFrames);
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < numFrames; ++i) {
+        const std::vector<float>& values = frames[i & 255];
+        FrameTiming timing = {};
+        timing.sampleIndex = i;
+        Clock::time_point t0 = Clock::now();
+        {
+            std::lock_guard<std::mutex> lock(printMutex);
+            if (printQueue.size() < PRINT_QUEUE_MAX) {
+                LoggedFrame logged;
+                std::copy(values.begin(), values.end(), logged.values);
+                logged.timing = timing;
+                printQueue.push_back(logged);
+            }
+            else {
+                ++unloggedFrames;
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(frameMutex);
+            latestFrame.assign(values.begin(), values.end());
+            int numContacts = tracker.update(latestFrame.data(), tareValues.data());
+            latestContacts.assign(tracker.contacts(), tracker.contacts() + numContacts);
+        }
+        publishUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - t0).count());
+    }
+    double seconds = secondsSince(start);
+    done = true;
+    gui.join();
+    printer.join();
+
+    report("publish_frames_per_s", numFrames / seconds, "frames/s");
+    report("publish_p99_us", percentile(publishUs, 0.99), "us");
+}
+
+static void benchContactMapping(int size, int numFrames)
+{
+    const int numPatterns = 200;
+    std::vector<float> frames(static_cast<size_t>(numPatterns) * size * size);
+    for (int f = 0; f < numPatterns; ++f) makeGridFrame(size, f, &frames[static_cast<size_t>(f) * size * size]);
+
+    ContactTracker tracker(size, size, CONTACT_THRESHOLD, CONTACT_MATCH_DISTANCE);
+    uint64_t sink = 0;
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < numFrames; ++i) {
+        int numContacts = tracker.update(&frames[static_cast<size_t>(i % numPatterns) * size * size], nullptr);
+        float force = 0.0f;
+        for (int c = 0; c < numContacts; ++c) force = std::max(force, tracker.contacts()[c].peak);
+        sink += mapForceToActuator(force, SCALING_DEFAULT, OFFSET_DEFAULT);
+    }
+    double seconds = secondsSince(start);
+    consume(sink);
+
+    char name[64];
+    snprintf(name, sizeof(name), "contact_map_%dx%d_frames_per_s", size, size);
+    report(name, numFrames / seconds, "frames/s");
+}
+
+static void benchPacketEncoding(int numPackets)
+{
+    uint8_t levels[FLUID_CHANNELS] = { 0 };
+    uint8_t packet[FLUID_VIBRATION_PACKET_SIZE];
+    uint64_t sink = 0;
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < numPackets; ++i) {
+        levels[i & (FLUID_CHANNELS - 1)] = static_cast<uint8_t>(i);
+        sink += encodeVibrationPacket(levels, packet) + packet[3];
+    }
+    report("packet_encode_per_s", numPackets / secondsSince(start), "packets/s");
+
+    // Waveform synthesis with a handful of voices mixed, no streaming thread
+    WaveformEngine engine;
+    engine.setPressure(0.6f);
+    WavePattern sine = { WAVE_SINE, 0x0f, 60.0f, 40.0f, 0.0f, 0.0f, { 0.01f, 0.05f, 0.8f, 0.1f } };
+    WavePattern pulse = { WAVE_PULSE, 0xf0, 80.0f, 8.0f, 0.25f, 0.0f, { 0.0f, 0.0f, 1.0f, 0.0f } };
+    WavePattern texture = { WAVE_TEXTURE, 0xff, 50.0f, 120.0f, 0.0f, 0.0f, { 0.0f, 0.0f, 1.0f, 0.05f } };
+    engine.play(sine);
+    engine.play(pulse);
+    engine.play(texture);
+    engine.play(sine);
+
+    start = Clock::now();
+    for (int i = 0; i < numPackets; ++i) {
+        engine.render(levels, 1.0f / WAVE_RATE_DEFAULT);
+        sink += levels[0];
+    }
+    report("waveform_render_per_s", numPackets / secondsSince(start), "updates/s");
+    consume(sink);
+}
+
+// Software version of the window's paint: one filled cell per taxel
+static void benchRendering(int numFrames)
+{
+    const int width = SENSOR_GRID_SIZE * RENDER_CELL_SIZE;
+    std::vector<uint32_t> pixels(static_cast<size_t>(width) * width);
+    std::vector<float> frame(SENSOR_TAXELS);
+    std::vector<float> tare(SENSOR_TAXELS, 1000.0f);
+    uint32_t seed = 3;
+    uint64_t sink = 0;
+
+    Clock::time_point start = Clock::now();
+    for (int f = 0; f < numFrames; ++f) {
+        if ((f & 63) == 0) {
+            std::string line = makeSensorLine(seed, f, false, true);
+            parseSensorLine(line.data(), line.data() + line.size(), ',', frame.data(), SENSOR_TAXELS, nullptr);
+        }
+        for (int y = 0; y < SENSOR_GRID_SIZE; ++y) {
+            for (int x = 0; x < SENSOR_GRID_SIZE; ++x) {
+                int index = y * SENSOR_GRID_SIZE + (SENSOR_GRID_SIZE - 1 - x); // Flip left-to-right
+                uint32_t red = pressureColorLevel(frame[index], tare[index]);
+                uint32_t color = (red << 16) | (255 - red);
+                for (int py = y * RENDER_CELL_SIZE; py < (y + 1) * RENDER_CELL_SIZE; ++py) {
+                    uint32_t* row = &pixels[static_cast<size_t>(py) * width + x * RENDER_CELL_SIZE];
+                    std::fill(row, row + RENDER_CELL_SIZE, color);
+                }
+            }
+        }
+        sink += pixels[f % pixels.size()];
+    }
+    report("render_frames_per_s", numFrames / secondsSince(start), "frames/s");
+    consume(sink);
+}
+
+#ifndef _WIN32
+
+static bool openRawPty(int& master, int& slave)
+{
+    if (openpty(&master, &slave, nullptr, nullptr, nullptr) != 0) return false;
+    struct termios settings;
+    tcgetattr(slave, &settings);
+    cfmakeraw(&settings);
+    tcsetattr(slave, TCSANOW, &settings);
+    return true;
+}
+
+// Where the waveform sink writes: the emulated driver port
+static int driverFd = -1;
+
+static int writeToDriver(const uint8_t levels[FLUID_CHANNELS])
+{
+    uint8_t packet[FLUID_VIBRATION_PACKET_SIZE];
+    size_t length = encodeVibrationPacket(levels, packet);
+    return write(driverFd, packet, length) == static_cast<ssize_t>(length) ? 0 : -1;
+}
+
+struct PipelineState {
+    std::mutex frameMutex;
+    std::vector<Contact> latestContacts;
+    SensorClock sensorClock;
+    std::atomic<uint64_t> frames;
+    std::atomic<int> stallMs;       // Sleep the reader takes before its next read
+    std::atomic<bool> stop;
+};
+
+// The visualizer's reader thread without the window: read, split lines,
+// parse, timestamp, find contacts and publish them
+static void readerLoop(int inFd, PipelineState* state)
+{
+    char buffer[512];
+    std::string lineBuffer;
+    ContactTracker tracker(SENSOR_GRID_SIZE, SENSOR_GRID_SIZE, CONTACT_THRESHOLD, CONTACT_MATCH_DISTANCE);
+    float tare[SENSOR_TAXELS];
+    bool hasTare = false;
+
+    while (!state->stop) {
+        int stallMs = state->stallMs.exchange(0);
+        if (stallMs > 0) std::this_thread::sleep_for(std::chrono::milliseconds(stallMs));
+
+        struct pollfd pfd = { inFd, POLLIN, 0 };
+        if (poll(&pfd, 1, 50) <= 0) continue;
+        ssize_t bytesRead = read(inFd, buffer, sizeof(buffer));
+        if (bytesRead <= 0) continue;
+        int64_t arrivalNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now().time_since_epoch()).count();
+        lineBuffer.append(buffer, static_cast<size_t>(bytesRead));
+
+        size_t newlinePos;
+        while ((newlinePos = lineBuffer.find('\n')) != std::string::npos) {
+            const char* line = lineBuffer.data();
+            float values[SENSOR_TAXELS + 1];
+            int badFields = 0;
+            size_t numValues = parseSensorLine(line, line + newlinePos, ',', values, SENSOR_TAXELS + 1, &badFields);
+            int64_t deviceCounter = numValues == SENSOR_TAXELS + 1 ? parseSensorCounter(line, line + newlinePos, ',') : -1;
+            lineBuffer.erase(0, newlinePos + 1);
+            if (badFields > 0 || (numValues != SENSOR_TAXELS && numValues != SENSOR_TAXELS + 1)) continue;
+
+            state->sensorClock.addFrame(arrivalNs, deviceCounter);
+            if (!hasTare) {
+                memcpy(tare, values, sizeof(tare));
+                hasTare = true;
+            }
+
+            int numContacts = tracker.update(values, tare);
+            std::lock_guard<std::mutex> lock(state->frameMutex);
+            state->latestContacts.assign(tracker.contacts(), tracker.contacts() + numContacts);
+            ++state->frames;
+        }
+    }
+}
+
+// The visualizer's GUI loop: one control step per CONTROL_LOOP_PERIOD_MS,
+// the waveform engine streams the result to the driver in between
+static void controlLoop(ActuatorControl* control, PipelineState* state)
+{
+    while (!state->stop) {
+        {
+            std::lock_guard<std::mutex> lock(state->frameMutex);
+            control->update(state->latestContacts.data(), static_cast<int>(state->latestContacts.size()),
+                SCALING_DEFAULT, OFFSET_DEFAULT);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(CONTROL_LOOP_PERIOD_MS));
+    }
+}
+
+// Read exactly length bytes or give up after the timeout
+static bool readFully(int fd, uint8_t* out, size_t length, int timeoutMs)
+{
+    size_t got = 0;
+    while (got < length) {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, timeoutMs) <= 0) return false;
+        ssize_t n = read(fd, out + got, length - got);
+        if (n <= 0) return false;
+        got += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static bool writeFully(int fd, const std::string& data)
+{
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = write(fd, data.data() + written, data.size() - written);
+        if (n <= 0) return false;
+        written += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Emulated sensor and driver around the real reader, control loop and
+// waveform engine. First a flood of frames for reader throughput, then a
+// 1 kHz stream with touches and releases: latency is from writing the
+// first frame of a touch (or release) to the driver seeing the level
+// cross halfway between idle and touched. The stream restarts the device
+// counter; from the middle touch on it sends no counter, as the current
+// firmware does, and the reader stalls for E2E_STALL_MS in the final idle
+// frames, so the clock has to ride that out without counting drops.
+// Returns false only when the pseudo-terminals are not available.
+static bool benchEndToEnd(int numFlood, int numTouches)
+{
+    int sensorMaster, sensorSlave, driverMaster, driverSlave;
+    if (!openRawPty(sensorMaster, sensorSlave) || !openRawPty(driverMaster, driverSlave)) {
+        fprintf(stderr, "Error opening pseudo-terminals, skipping end-to-end\n");
+        return false;
+    }
+
+    PipelineState state;
+    state.latestContacts.reserve(CONTACT_MAX_DEFAULT);
+    state.frames = 0;
+    state.stallMs = 0;
+    state.stop = false;
+    WaveformEngine engine;
+    ActuatorControl control(engine);
+    driverFd = driverSlave;
+    engine.start(writeToDriver);
+    control.start();
+    std::thread reader(readerLoop, sensorSlave, &state);
+    std::thread controller(controlLoop, &control, &state);
+
+    // Flood: the emulated sensor writes as fast as the port takes it
+    uint32_t seed = 11;
+    std::string flood;
+    for (int i = 0; i < numFlood; ++i) flood += makeSensorLine(seed, i, true, false);
+    Clock::time_point start = Clock::now();
+    bool ok = writeFully(sensorMaster, flood);
+    while (ok && state.frames < static_cast<uint64_t>(numFlood)) {
+        ok = secondsSince(start) < E2E_TIMEOUT_MS / 1000.0;
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    double floodSeconds = secondsSince(start);
+    const bool floodOk = ok;
+
+    // Touch schedule, spaced irregularly so touches do not line up with the control loop
+    std::vector<int> toggleFrames;
+    int streamFrames = E2E_IDLE_FRAMES;
+    for (int i = 0; i < numTouches * 2; ++i) {
+        toggleFrames.push_back(streamFrames);
+        streamFrames += E2E_TOUCH_FRAMES + (i * 37) % E2E_TOUCH_FRAMES;
+    }
+    int stallFrame = streamFrames + E2E_IDLE_FRAMES / 2;
+    streamFrames += E2E_IDLE_FRAMES;
+    int counterlessFrame = toggleFrames[numTouches];
+    int totalFrames = numFlood + streamFrames;
+
+    std::vector<Clock::time_point> toggleTimes(toggleFrames.size());
+    std::atomic<bool> sensorDone(false);
+    std::thread sensor([&]() {
+        const Clock::duration period = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(1.0 / E2E_SENSOR_RATE_HZ));
+        Clock::time_point deadline = Clock::now();
+        bool touched = false;
+        size_t next = 0;
+        for (int frame = 0; floodOk && frame < streamFrames; ++frame) {
+            if (next < toggleFrames.size() && frame == toggleFrames[next]) {
+                touched = !touched;
+                toggleTimes[next++] = Clock::now();
+            }
+            if (frame == stallFrame) state.stallMs = E2E_STALL_MS;
+            if (!writeFully(sensorMaster, makeSensorLine(seed, frame, frame < counterlessFrame, touched))) break;
+            deadline += period;
+            std::this_thread::sleep_until(deadline);
+        }
+        sensorDone = true;
+    });
+
+    // Driver side: every packet the engine streams, noting when the level crosses
+    uint8_t idleLevel = mapForceToActuator(0.0f, SCALING_DEFAULT, OFFSET_DEFAULT);
+    uint8_t touchLevel = mapForceToActuator(E2E_TOUCH_FORCE, SCALING_DEFAULT, OFFSET_DEFAULT);
+    int halfway = (idleLevel + touchLevel) / 2;
+    uint8_t noLevels[FLUID_CHANNELS] = { 0 };
+    uint8_t header[FLUID_VIBRATION_PACKET_SIZE];    // Only its first 3 bytes are compared
+    encodeVibrationPacket(noLevels, header);
+    std::vector<Clock::time_point> changeTimes;
+    bool high = false;
+    Clock::time_point giveUp = Clock::time_point::max();
+    uint8_t packet[FLUID_VIBRATION_PACKET_SIZE];
+    while (ok && changeTimes.size() < toggleFrames.size() && Clock::now() < giveUp) {
+        ok = readFully(driverMaster, packet, sizeof(packet), E2E_TIMEOUT_MS) && memcmp(packet, header, 3) == 0;
+        if (ok && (packet[3] >= halfway) != high) {
+            high = !high;
+            changeTimes.push_back(Clock::now());
+        }
+        if (sensorDone && giveUp == Clock::time_point::max()) {
+            giveUp = Clock::now() + std::chrono::milliseconds(E2E_TIMEOUT_MS);
+        }
+    }
+    sensor.join();
+    start = Clock::now();
+    while (state.frames < static_cast<uint64_t>(totalFrames) && secondsSince(start) < E2E_TIMEOUT_MS / 1000.0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    state.stop = true;
+    reader.join();
+    controller.join();
+    control.stop();
+    engine.stop();
+    WaveEngineStats waveStats = engine.stats();
+    close(sensorMaster);
+    close(sensorSlave);
+    close(driverMaster);
+    close(driverSlave);
+
+    if (!ok || changeTimes.size() != toggleFrames.size()) {
+        // Nothing reported, so the e2e thresholds fail as unmeasured
+        fprintf(stderr, "End-to-end: the emulated driver saw %d of %d level changes\n",
+            static_cast<int>(changeTimes.size()), static_cast<int>(toggleFrames.size()));
+        return true;
+    }
+
+    std::vector<double> latencyUs;
+    for (size_t i = 0; i < changeTimes.size(); ++i) {
+        latencyUs.push_back(std::chrono::duration<double, std::micro>(changeTimes[i] - toggleTimes[i]).count());
+    }
+    report("e2e_reader_frames_per_s", numFlood / floodSeconds, "frames/s");
+    report("e2e_latency_p50_us", percentile(latencyUs, 0.5), "us");
+    report("e2e_latency_p99_us", percentile(latencyUs, 0.99), "us");
+    report("e2e_update_rate_hz", waveStats.rateHz, "Hz");
+    report("e2e_update_jitter_us", waveStats.jitterStdUs, "us");
+    report("e2e_frames_lost", static_cast<double>(totalFrames - static_cast<int64_t>(state.frames)), "frames");
+    report("e2e_clock_drops", static_cast<double>(state.sensorClock.droppedTotal()), "frames");
+    return true;
+}
+
+#endif
+
+struct Threshold {
+    std::string metric;
+    std::string op;
+    double limit;
+    double value;
+    bool found;
+    bool pass;
+};
+
+// One "metric >= limit" or "metric <= limit" per line, # starts a comment
+static bool loadThresholds(const char* path, std::vector<Threshold>& thresholds)
+{
+    std::ifstream file(path);
+    if (!file) return false;
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+        std::istringstream ss(line);
+        Threshold t = {};
+        if (!(ss >> t.metric >> t.op >> t.limit)) continue;
+        if (t.op != ">=" && t.op != "<=") {
+            fprintf(stderr, "Unknown comparison in thresholds: %s\n", line.c_str());
+            return false;
+        }
+        thresholds.push_back(t);
+    }
+    return true;
+}
+
+// A threshold on a metric that was not reported fails, so a typo or a
+// renamed metric cannot quietly disable a gate. The only exception is the
+// end-to-end stage when this machine cannot run it.
+static void checkThresholds(std::vector<Threshold>& thresholds, bool e2eSkipped)
+{
+    for (Threshold& t : thresholds) {
+        t.pass = false;
+        for (const Metric& m : metrics) {
+            if (m.name != t.metric) continue;
+            t.found = true;
+            t.value = m.value;
+            t.pass = t.op == ">=" ? m.value >= t.limit : m.value <= t.limit;
+        }
+        if (!t.found && e2eSkipped && t.metric.compare(0, 4, "e2e_") == 0) {
+            t.pass = true;
+            fprintf(stderr, "  %-32s not measured, skipped\n", t.metric.c_str());
+        }
+        else if (!t.found) {
+            fprintf(stderr, "  REGRESSION %s was not reported (unknown metric or stage failed)\n", t.metric.c_str());
+        }
+        else if (!t.pass) {
+            fprintf(stderr, "  REGRESSION %s = %.1f, limit %s %.1f\n", t.metric.c_str(), t.value, t.op.c_str(), t.limit);
+        }
+    }
+}
+
+static void writeJson(FILE* out, const std::vector<Threshold>& thresholds, bool pass)
+{
+    fprintf(out, "{\n  \"metrics\": {\n");
+    for (size_t i = 0; i < metrics.size(); ++i) {
+        fprintf(out, "    \"%s\": { \"value\": %.3f, \"unit\": \"%s\" }%s\n", metrics[i].name.c_str(),
+            metrics[i].value, metrics[i].unit.c_str(), i + 1 < metrics.size() ? "," : "");
+    }
+    fprintf(out, "  },\n  \"thresholds\": [\n");
+    for (size_t i = 0; i < thresholds.size(); ++i) {
+        const Threshold& t = thresholds[i];
+        fprintf(out, "    { \"metric\": \"%s\", \"op\": \"%s\", \"limit\": %.3f, \"measured\": %s, \"pass\": %s }%s\n",
+            t.metric.c_str(), t.op.c_str(), t.limit, t.found ? "true" : "false", t.pass ? "true" : "false",
+            i + 1 < thresholds.size() ? "," : "");
+    }
+    fprintf(out, "  ],\n  \"pass\": %s\n}\n", pass ? "true" : "false");
+}
+
+int main(int argc, char** argv)
+{
+    const char* jsonPath = nullptr;
+    const char* thresholdsPath = nullptr;
+    int scale = 10;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--json") && i + 1 < argc) jsonPath = argv[++i];
+        else if (!strcmp(argv[i], "--thresholds") && i + 1 < argc) thresholdsPath = argv[++i];
+        else if (!strcmp(argv[i], "--quick")) scale = 1;
+        else {
+            fprintf(stderr, "Usage: %s [--json FILE] [--thresholds FILE] [--quick]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<Threshold> thresholds;
+    if (thresholdsPath && !loadThresholds(thresholdsPath, thresholds)) {
+        fprintf(stderr, "Error reading thresholds: %s\n", thresholdsPath);
+        return 1;
+    }
+
+    fprintf(stderr, "Pipeline benchmark\n");
+    benchCsvParse(10000);
+    benchFramePublish(20000 * scale);
+    benchContactMapping(SENSOR_GRID_SIZE, 100000 * scale);
+    benchContactMapping(32, 2000 * scale);
+    benchPacketEncoding(200000 * scale);
+    benchRendering(200 * scale);
+    bool e2eSkipped = true;
+#ifndef _WIN32
+    e2eSkipped = !benchEndToEnd(500 * scale, 6 + scale);
+#endif
+
+    checkThresholds(thresholds, e2eSkipped);
+    bool pass = true;
+    for (const Threshold& t : thresholds) pass = pass && t.pass;
+
+    writeJson(stdout, thresholds, pass);
+    if (jsonPath) {
+        FILE* out = fopen(jsonPath, "w");
+        if (!out) {
+            fprintf(stderr, "Error writing %s\n", jsonPath);
+            return 1;
+        }
+        writeJson(out, thresholds, pass);
+        fclose(out);
+    }
+
+    fprintf(stderr, pass ? "All thresholds met\n" : "Performance regression detected\n");
+    return pass ? 0 : 2;
+}
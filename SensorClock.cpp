@@ -0,0 +1,240 @@
+#include "SensorClock.h"
+
+#include <math.h>
+
+SensorClock::SensorClock()
+{
+    reset();
+}
+
+void SensorClock::reset()
+{
+    head = 0;
+    count = 0;
+    lastIndex = -1;
+    lastCounter = -1;
+    lastArrival = 0;
+    dropped = 0;
+    burstFrames = 0;
+    pendingFrames = 0;
+    pendingGap = 0;
+    pendingPeriod = 0.0;
+    confirmBursts = 0;
+    rejectedFits = 0;
+    windowFilled = false;
+    period = 0.0;
+    offsetNs = 0.0;
+    baseNs = 0;
+}
+
+FrameTiming SensorClock::addFrame(int64_t arrivalNs, int64_t deviceCounter)
+{
+    // A counter going backwards wrapped if it stepped just past a whole
+    // number of bytes; anything else (or a repeat) means the device
+    // restarted and the old fit no longer applies
+    int64_t counterStep = 0;
+    if (deviceCounter >= 0 && lastCounter >= 0) {
+        counterStep = deviceCounter - lastCounter;
+        if (counterStep < 0) {
+            int64_t modulus = 256;
+            while (modulus <= lastCounter && modulus < (INT64_C(1) << 56)) modulus <<= 8;
+            counterStep += modulus;
+            if (counterStep > CLOCK_WRAP_MAX_STEP) counterStep = 0;
+        }
+        if (counterStep <= 0) reset();
+    }
+    if (lastIndex < 0) baseNs = arrivalNs;
+
+    FrameTiming timing = {};
+    timing.arrivalNs = arrivalNs;
+    timing.bunched = lastIndex >= 0 &&
+        (arrivalNs == lastArrival || (locked() && arrivalNs - lastArrival < period / 4));
+
+    int64_t previousIndex = lastIndex;
+    if (deviceCounter < 0 && lastIndex >= 0 && !timing.bunched) {
+        // The previous burst has drained (reads returning back to back are
+        // one burst). A stall or a split batch catches up within a few
+        // bursts; after a drop every burst keeps ending late.
+        if (locked()) {
+            double late = static_cast<double>(lastArrival - baseNs) - offsetNs - period * lastIndex;
+            int64_t gap = late > 0.0 ? llround(late / period) : 0;
+            if (gap == 0) {
+                pendingGap = 0;
+                pendingFrames = 0;
+            }
+            else if (pendingGap == 0 || fabs(period - pendingPeriod) > period * CLOCK_SLOPE_SETTLED) {
+                // The first late burst, or the fit is still moving and the
+                // gap may be its own doing: start counting from here
+                pendingGap = gap;
+                pendingFrames = 0;
+                pendingPeriod = period;
+                confirmBursts = 0;
+            }
+            else {
+                // The first late burst may have lost frames from its end
+                // rather than before it, so it does not bound the gap
+                pendingGap = confirmBursts == 0 || gap < pendingGap ? gap : pendingGap;
+                pendingFrames += burstFrames;
+                if (++confirmBursts >= CLOCK_DROP_CONFIRM) {
+                    // The samples went missing in or right before the first
+                    // late burst; the frames after it are re-indexed, the
+                    // ones in it just stay above the fit
+                    shiftRecent(pendingFrames, pendingGap);
+                    lastIndex += pendingGap;
+                    pendingGap = 0;
+                    pendingFrames = 0;
+                }
+            }
+        }
+        burstFrames = 0;
+    }
+
+    int64_t index = lastIndex + 1;
+    if (deviceCounter >= 0 && lastCounter >= 0) {
+        index = lastIndex + counterStep;
+    }
+
+    timing.sampleIndex = index;
+    timing.dropped = previousIndex >= 0 ? static_cast<int>(index - previousIndex - 1) : 0;
+    dropped += timing.dropped;
+
+    indices[head] = index;
+    arrivals[head] = arrivalNs;
+    head = (head + 1) % CLOCK_WINDOW;
+    if (count < CLOCK_WINDOW) ++count;
+    if (count == CLOCK_WINDOW) windowFilled = true;
+    ++burstFrames;
+
+    lastIndex = index;
+    lastCounter = deviceCounter;
+    lastArrival = arrivalNs;
+
+    // Refit once per burst: until a burst has drained, its last frame so far
+    // can sit anywhere above the line and drag the end of the hull with it
+    if (count >= CLOCK_MIN_FIT && !timing.bunched) fit();
+    if (locked()) {
+        timing.sampleNs = baseNs + llround(offsetNs + period * index);
+    }
+    else {
+        timing.sampleNs = arrivalNs;
+    }
+    return timing;
+}
+
+void SensorClock::shiftRecent(int frames, int64_t by)
+{
+    if (frames > count) frames = count;
+    for (int k = 1; k <= frames; ++k) {
+        indices[(head - k + CLOCK_WINDOW) % CLOCK_WINDOW] += by;
+    }
+}
+
+void SensorClock::fit()
+{
+    // Refine the hull edge by least squares over the frames within a
+    // quarter period of it; batching and stalls put the rest well above.
+    // Too few of them (a stall filling most of the window) and the edge is
+    // no better than the period already held.
+    double previousPeriod = period;
+    if (fitHull() && !fitSlope(offsetNs + period / 4)) {
+        period = previousPeriod;
+        ++rejectedFits;
+    }
+    if (period > 0.0) offsetNs = lowerEnvelope();
+}
+
+bool SensorClock::fitHull()
+{
+    // Monotone chain over the window, oldest first: indices only increase
+    int start = (head - count + CLOCK_WINDOW) % CLOCK_WINDOW;
+    int size = 0;
+    double meanX = 0.0;
+    for (int k = 0; k < count; ++k) {
+        int i = (start + k) % CLOCK_WINDOW;
+        double x = static_cast<double>(indices[i]);
+        double y = static_cast<double>(arrivals[i] - baseNs);
+        meanX += x;
+        while (size >= 2) {
+            int a = hull[size - 2];
+            int b = hull[size - 1];
+            double ax = static_cast<double>(indices[a]);
+            double ay = static_cast<double>(arrivals[a] - baseNs);
+            double cross = (static_cast<double>(indices[b]) - ax) * (y - ay) -
+                (static_cast<double>(arrivals[b] - baseNs) - ay) * (x - ax);
+            if (cross > 0.0) break;
+            --size;
+        }
+        hull[size++] = i;
+    }
+    meanX /= count;
+
+    // The edge under the middle of the window, or failing that the longest
+    // acceptable one. Once locked a held burst's flat edges are rejected, and
+    // a period that stays out of tolerance for a whole window is a new rate.
+    bool constrained = windowFilled && period > 0.0 && rejectedFits < CLOCK_WINDOW;
+    int best = -1;
+    double bestSpan = 0.0;
+    for (int j = 0; j + 1 < size; ++j) {
+        double x0 = static_cast<double>(indices[hull[j]]);
+        double x1 = static_cast<double>(indices[hull[j + 1]]);
+        double slope = static_cast<double>(arrivals[hull[j + 1]] - arrivals[hull[j]]) / (x1 - x0);
+        if (slope <= 0.0) continue;
+        if (constrained && fabs(slope - period) > period * CLOCK_SLOPE_TOLERANCE) continue;
+        if (x0 <= meanX && meanX <= x1) {
+            best = j;
+            break;
+        }
+        if (x1 - x0 > bestSpan) {
+            best = j;
+            bestSpan = x1 - x0;
+        }
+    }
+    if (best < 0) {
+        ++rejectedFits;
+        return false;
+    }
+    rejectedFits = 0;
+
+    int a = hull[best];
+    int b = hull[best + 1];
+    period = static_cast<double>(arrivals[b] - arrivals[a]) / static_cast<double>(indices[b] - indices[a]);
+    offsetNs = static_cast<double>(arrivals[a] - baseNs) - period * indices[a];
+    return true;
+}
+
+bool SensorClock::fitSlope(double maxResidual)
+{
+    double meanX = 0.0;
+    double meanY = 0.0;
+    int used = 0;
+    for (int i = 0; i < count; ++i) {
+        if (residual(i) > maxResidual) continue;
+        meanX += static_cast<double>(indices[i]);
+        meanY += static_cast<double>(arrivals[i] - baseNs);
+        ++used;
+    }
+    if (used < CLOCK_MIN_FIT) return false;
+    meanX /= used;
+    meanY /= used;
+
+    double sxy = 0.0;
+    double sxx = 0.0;
+    for (int i = 0; i < count; ++i) {
+        if (residual(i) > maxResidual) continue;
+        double dx = indices[i] - meanX;
+        sxy += dx * (static_cast<double>(arrivals[i] - baseNs) - meanY);
+        sxx += dx * dx;
+    }
+    if (sxx <= 0.0 || sxy <= 0.0) return false;
+    period = sxy / sxx;
+    return true;
+}
+
+double SensorClock::lowerEnvelope() const
+{
+    double minResidual = INFINITY;
+    for (int i = 0; i < count; ++i) {
+        if (residual(i) < minResidual) minResidual = residual(i);
+    }
+    return minResidual;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdint.h>
+
+#define CLOCK_WINDOW 256        // Frames the clock fit looks back over
+#define CLOCK_MIN_FIT 16        // Frames needed before sample times are estimated
+#define CLOCK_DROP_CONFIRM 16   // Bursts a gap must persist for before it counts as drops
+#define CLOCK_SLOPE_TOLERANCE 0.02 // Relative period change a locked fit accepts
+#define CLOCK_SLOPE_SETTLED 0.001   // Relative period change drops are confirmed across
+#define CLOCK_WRAP_MAX_STEP 1024    // Largest counter step still read as a wrap
+
+struct FrameTiming {
+    int64_t arrivalNs;      // Host time the read that completed the frame returned
+    int64_t sampleNs;       // Estimated host time the sensor took the sample
+    int64_t sampleIndex;    // Samples since the clock started, counting drops
+    int dropped;            // Samples found missing since the previous frame
+    bool bunched;           // Delivered in the same burst as the previous frame
+};
+
+// Fits the sensor's sample clock to the host clock from frame arrivals.
+//
+// Transport only ever adds delay, so the sample clock is a line under every
+// arrival. The fit takes the lower convex hull of arrival time over sample
+// index, picks the hull edge under the middle of the window (once locked,
+// only edges within CLOCK_SLOPE_TOLERANCE of the previous period), then
+// refines the period by least squares over the frames close to that edge.
+// Late frames (stalls, batching, drops not confirmed yet) sit above the
+// hull and cannot tilt it. The offset is the lower envelope of the residuals.
+//
+// A device counter, when the firmware sends one, gives the exact sample
+// index; it may wrap at any whole number of bytes. Without it a late frame
+// may be a host stall (the held frames then arrive together) or a drop, so
+// drops are only counted once CLOCK_DROP_CONFIRM bursts in a row have ended
+// late by whole periods while the period held still; a stall catches up
+// long before that. They are reported on the first frame after that, and
+// the indices of the late frames are corrected within the window.
+class SensorClock {
+public:
+    SensorClock();
+
+    // deviceCounter < 0 when the frame carries no counter
+    FrameTiming addFrame(int64_t arrivalNs, int64_t deviceCounter);
+
+    void reset();
+
+    bool locked() const { return count >= CLOCK_MIN_FIT && period > 0.0; }
+    double periodNs() const { return period; }
+    double rateHz() const { return period > 0.0 ? 1e9 / period : 0.0; }
+    int64_t droppedTotal() const { return dropped; }
+
+private:
+    void fit();
+    bool fitHull();
+    bool fitSlope(double maxResidual);
+    double lowerEnvelope() const;
+    double residual(int i) const {
+        return static_cast<double>(arrivals[i] - baseNs) - period * indices[i];
+    }
+    void shiftRecent(int frames, int64_t by);
+
+    int64_t indices[CLOCK_WINDOW];
+    int64_t arrivals[CLOCK_WINDOW];
+    int head;
+    int count;
+
+    int64_t lastIndex;
+    int64_t lastCounter;
+    int64_t lastArrival;
+    int64_t dropped;
+    int burstFrames;        // Frames in the burst being received
+    int pendingFrames;      // Frames in the late bursts after the first
+    int64_t pendingGap;     // Fewest periods any of those bursts ended late by
+    double pendingPeriod;   // Period when the late bursts started
+    int confirmBursts;      // Late bursts since the first
+    int rejectedFits;       // Fits in a row with no hull edge near the period
+    bool windowFilled;      // The window has been full since the last reset
+    int hull[CLOCK_WINDOW]; // Window slots on the lower hull, oldest first
+
+    double period;          // ns per sample
+    double offsetNs;        // Sample time of index 0, relative to baseNs
+    int64_t baseNs;         // Arrival of the first frame, keeps the doubles small
+};
@@ -0,0 +1,133 @@
+// Replays simulated 1 kHz sensor streams through SensorClock and checks the
+// clock rides out host stalls without inventing drops, still finds real
+// ones, and follows a 16-bit device counter through its wraps.
+//
+// Frames reach the host 200 us after they are sampled, plus jitter. A stall
+// holds every frame until it ends, then delivers them in one read or split
+// into 512-byte reads of a few lines each. Exits non-zero on any failure.
+
+#include "SensorClock.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <random>
+
+#define SIM_PERIOD_NS 1000000       // 1 kHz sensor
+#define SIM_DELAY_NS 200000         // Transport delay of an undisturbed frame
+#define SIM_JITTER_NS 20000         // Spread of the extra transport delay
+#define SIM_FRAMES 12000
+#define SIM_LINES_PER_READ 5        // Sensor lines in one 512-byte read
+#define SIM_READ_GAP_NS 20000       // Between back-to-back reads draining a backlog
+#define SIM_MAX_ERROR_NS 100000     // Allowed sample time error once settled
+#define SIM_SETTLE_FRAMES 500       // Frames after a start or a drop not checked
+
+struct Scenario {
+    const char* name;
+    int stallMs;            // Length of each stall, 0 for none
+    bool splitReads;        // Drain the backlog in 512-byte reads
+    bool counter;           // Frames carry a 16-bit counter
+    int dropFrames;         // Samples lost at DROP_AT
+};
+
+static const int STALL_AT[] = { 3000, 6000, 9000 };
+static const int DROP_AT = 7500;
+
+static bool runScenario(const Scenario& scenario)
+{
+    std::mt19937 rng(1);
+    std::normal_distribution<double> jitter(0.0, SIM_JITTER_NS);
+    SensorClock clock;
+
+    const int64_t startNs = 1000000000;
+    int64_t dropped = 0;
+    int64_t maxErrorNs = 0;
+    int64_t indexError = 0;
+    int64_t heldUntil = -1;         // Release time of the stall being simulated
+    int heldLines = 0;              // Lines of it already read back
+    int64_t lastDrop = 0;
+
+    for (int i = 0; i < SIM_FRAMES; ++i) {
+        if (i >= DROP_AT && i < DROP_AT + scenario.dropFrames) continue;
+
+        int64_t sampleNs = startNs + static_cast<int64_t>(i) * SIM_PERIOD_NS;
+        int64_t arrivalNs = sampleNs + SIM_DELAY_NS + static_cast<int64_t>(fabs(jitter(rng)));
+
+        for (int stall : STALL_AT) {
+            if (scenario.stallMs > 0 && i == stall) {
+                heldUntil = sampleNs + static_cast<int64_t>(scenario.stallMs) * 1000000;
+                heldLines = 0;
+            }
+        }
+        if (heldUntil >= 0) {
+            if (arrivalNs < heldUntil) {
+                arrivalNs = heldUntil;
+                if (scenario.splitReads) {
+                    arrivalNs += (heldLines / SIM_LINES_PER_READ) * SIM_READ_GAP_NS;
+                }
+                ++heldLines;
+            }
+            else {
+                heldUntil = -1;
+            }
+        }
+
+        int64_t counter = scenario.counter ? (60000 + i) % 65536 : -1;
+        FrameTiming timing = clock.addFrame(arrivalNs, counter);
+        dropped += timing.dropped;
+        if (timing.dropped > 0) lastDrop = i;
+
+        indexError = timing.sampleIndex - i;
+        bool settling = i < SIM_SETTLE_FRAMES ||
+            (scenario.dropFrames > 0 && i >= DROP_AT && i < DROP_AT + SIM_SETTLE_FRAMES);
+        if (!settling && indexError == 0) {
+            int64_t error = timing.sampleNs - (sampleNs + SIM_DELAY_NS);
+            if (error < 0) error = -error;
+            if (error > maxErrorNs) maxErrorNs = error;
+        }
+    }
+
+    double periodError = fabs(clock.periodNs() - SIM_PERIOD_NS) / SIM_PERIOD_NS;
+    bool ok = dropped == scenario.dropFrames &&
+        indexError == 0 &&
+        periodError < 0.001 &&
+        maxErrorNs <= SIM_MAX_ERROR_NS &&
+        (scenario.dropFrames == 0 || lastDrop < DROP_AT + SIM_SETTLE_FRAMES);
+
+    printf("%-28s drops %5lld (expected %d)  index error %6lld  period error %6.3f%%  max sample error %7.1f us  %s\n",
+        scenario.name, static_cast<long long>(dropped), scenario.dropFrames,
+        static_cast<long long>(indexError), periodError * 100.0, maxErrorNs / 1000.0,
+        ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main()
+{
+    static const Scenario scenarios[] = {
+        { "steady",                   0, false, false, 0 },
+        { "stall 30 ms",             30, false, false, 0 },
+        { "stall 60 ms",             60, false, false, 0 },
+        { "stall 100 ms",           100, false, false, 0 },
+        { "stall 200 ms",           200, false, false, 0 },
+        { "stall 30 ms split",       30, true,  false, 0 },
+        { "stall 60 ms split",       60, true,  false, 0 },
+        { "stall 100 ms split",     100, true,  false, 0 },
+        { "stall 200 ms split",     200, true,  false, 0 },
+        { "drop 7",                   0, false, false, 7 },
+        { "drop 7, stall 60 ms split", 60, true, false, 7 },
+        { "counter wraps",            0, false, true,  0 },
+        { "counter, stall 200 ms",  200, true,  true,  0 },
+        { "counter wraps, drop 7",    0, false, true,  7 },
+    };
+
+    int failed = 0;
+    for (const Scenario& scenario : scenarios) {
+        if (!runScenario(scenario)) ++failed;
+    }
+    if (failed > 0) {
+        fprintf(stderr, "%d clock scenario(s) failed\n", failed);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,125 @@
+#include "SensorPipeline.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static bool isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Plain decimals ("1234.5", "-12") are parsed inline since this runs for
+// every field of every frame; anything else (exponents, inf, ...) goes
+// through strtof. Returns where parsing stopped, begin if nothing parsed.
+static const char* parseNumber(const char* begin, const char* end, float* out)
+{
+    static const double powersOf10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+        1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18 };
+
+    const char* p = begin;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int fractionDigits = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        mantissa = mantissa * 10 + (*p++ - '0');
+        ++digits;
+    }
+    if (p < end && *p == '.') {
+        ++p;
+        while (p < end && *p >= '0' && *p <= '9') {
+            mantissa = mantissa * 10 + (*p++ - '0');
+            ++digits;
+            ++fractionDigits;
+        }
+    }
+
+    bool simple = digits > 0 && digits <= 18 && !(p < end && (*p == 'e' || *p == 'E'));
+    if (!simple) {
+        // Nothing numeric, and not inf / nan either
+        if (digits == 0 && !(p < end && (*p == 'i' || *p == 'I' || *p == 'n' || *p == 'N'))) {
+            return begin;
+        }
+        char* parsedEnd = nullptr;
+        *out = strtof(begin, &parsedEnd);
+        return parsedEnd;
+    }
+
+    double value = static_cast<double>(mantissa) / powersOf10[fractionDigits];
+    *out = static_cast<float>(negative ? -value : value);
+    return p;
+}
+
+size_t parseSensorLine(const char* begin, const char* end, char delimiter,
+    float* out, size_t maxValues, int* badFields)
+{
+    size_t fields = 0;
+    const char* start = begin;
+
+    // Trailing delimiters and line endings are not fields
+    while (end > begin && (isBlank(end[-1]) || end[-1] == delimiter)) --end;
+    if (end == begin) return 0;
+
+    while (start <= end) {
+        const char* tokenEnd = static_cast<const char*>(memchr(start, delimiter, end - start));
+        if (!tokenEnd) tokenEnd = end;
+
+        const char* first = start;
+        while (first < tokenEnd && isBlank(*first)) ++first;
+
+        float value = 0.0f;
+        const char* parsedEnd = parseNumber(first, tokenEnd, &value);
+        const char* rest = parsedEnd;
+        while (rest < tokenEnd && isBlank(*rest)) ++rest;
+
+        // A bad field keeps its slot so the fields after it do not shift.
+        // nan / inf (how firmware prints a broken reading) are bad fields too.
+        if (parsedEnd == first || parsedEnd > tokenEnd || rest != tokenEnd || !isfinite(value)) {
+            value = NAN;
+            if (badFields) ++*badFields;
+        }
+        if (fields < maxValues) out[fields] = value;
+        ++fields;
+        start = tokenEnd + 1;
+    }
+    return fields;
+}
+
+int64_t parseSensorCounter(const char* begin, const char* end, char delimiter)
+{
+    while (end > begin && (isBlank(end[-1]) || end[-1] == delimiter)) --end;
+    const char* field = end;
+    while (field > begin && field[-1] != delimiter) --field;
+    while (field < end && isBlank(*field)) ++field;
+
+    char* parsedEnd = nullptr;
+    long long counter = strtoll(field, &parsedEnd, 10);
+    if (parsedEnd == field || parsedEnd != end || counter < 0) return -1;
+    return counter;
+}
+
+uint8_t mapForceToActuator(float force, float scalingFactor, float offsetValue)
+{
+    // Apply scaling to increase responsiveness
+    double scaledValue = (force / (double)PRESSURE_MAX) * 254 * scalingFactor + offsetValue;
+
+    // Map to actuator range, ensuring it doesn't exceed PRESSURE_SCALED_MAX
+    if (scaledValue < PRESSURE_SCALED_MIN) scaledValue = PRESSURE_SCALED_MIN;
+    if (scaledValue > PRESSURE_SCALED_MAX) scaledValue = PRESSURE_SCALED_MAX;
+    return static_cast<uint8_t>(scaledValue);
+}
+
+uint8_t pressureColorLevel(float pressure, float tare)
+{
+    float adjustedPressure = pressure - tare;
+    if (adjustedPressure < PRESSURE_MIN) adjustedPressure = PRESSURE_MIN;
+    if (adjustedPressure > PRESSURE_MAX) adjustedPressure = PRESSURE_MAX;
+    float normalized = (adjustedPressure - PRESSURE_MIN) / (PRESSURE_MAX - PRESSURE_MIN);
+    return static_cast<uint8_t>(normalized * 255);
+}
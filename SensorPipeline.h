@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Shared between the live visualizer and the offline tools so both
+// interpret frames and compute actuator levels the same way.
+
+#define SENSOR_GRID_SIZE 4
+#define SENSOR_TAXELS (SENSOR_GRID_SIZE * SENSOR_GRID_SIZE)
+#define PRESSURE_MIN 0
+#define PRESSURE_MAX 6500
+#define PRESSURE_SCALED_MIN 0
+#define PRESSURE_SCALED_MAX 255
+#define SCALING_DEFAULT 1.5f
+#define OFFSET_DEFAULT 120.0f
+#define CONTACT_THRESHOLD 150.0f      // Tared pressure a taxel needs to count as touched
+#define CONTACT_MATCH_DISTANCE 1.5f   // Max centroid travel (taxels) between frames
+
+// Parse one line of delimiter separated floats from [begin, end).
+// Up to maxValues are written to out; the return value is the number of
+// fields on the line, so callers can reject frames of the wrong size.
+// Fields that are not finite numbers (including "nan" and "inf") still
+// count and are stored as NAN, and are also counted in badFields; callers
+// should drop lines where it is > 0.
+// The line must be followed by a newline or terminator, not more digits.
+size_t parseSensorLine(const char* begin, const char* end, char delimiter,
+    float* out, size_t maxValues, int* badFields);
+
+// Last field of the line as an integer, -1 if it is not one. Sample
+// counters and timestamps go through this: a float stops counting exactly
+// after 2^24.
+int64_t parseSensorCounter(const char* begin, const char* end, char delimiter);
+
+// Map a tared force to an actuator level, same curve as the live loop
+uint8_t mapForceToActuator(float force, float scalingFactor, float offsetValue);
+
+// Red level of the blue (0) to red (255) gradient a taxel is drawn with;
+// the blue level is 255 minus this
+uint8_t pressureColorLevel(float pressure, float tare);
@@ -0,0 +1,527 @@
+// Offline analysis of recorded rig sessions.
+//
+// Input is the visualizer's console log: one line per frame with the 16
+// taxel values and the interval since the previous sample in ns (from the
+// estimated sensor clock), then the host arrival time, the latency from
+// sample to arrival, the sample index and the drops before it, tab
+// separated. Logs from before the timing columns (taxels and interval
+// only) are still read. Other console output mixed into the log is
+// skipped. The file is cut into chunks which are processed on all cores,
+// each worker keeps its own statistics and steals chunks from the others
+// once its own queue is empty.
+//
+// Usage: SessionAnalyzer <log> [--threads N] [--chunk-mb N] [--scaling F] [--offset F]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SensorPipeline.h"
+#include "ContactTracker.h"
+#include "ActuatorControl.h"
+#include "WaveformEngine.h"
+
+#define LOG_FIELDS_UNTIMED (SENSOR_TAXELS + 1)  // Taxels, then the sample interval
+#define LOG_FIELDS (SENSOR_TAXELS + 5)          // ... arrival, latency, sample index, drops
+#define LOG_INTERVAL SENSOR_TAXELS              // Columns read as integers
+#define LOG_ARRIVAL (SENSOR_TAXELS + 1)
+#define LOG_LATENCY (SENSOR_TAXELS + 2)
+#define LOG_DROPPED (SENSOR_TAXELS + 4)
+#define HISTOGRAM_SUB_BITS 10                   // Log-linear histogram, 1024 buckets per octave
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)   // ~0.1% resolution, 0.5 us at 1 ms
+#define HISTOGRAM_BUCKETS ((64 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS)
+#define CHUNK_MB_DEFAULT 32
+#define READ_BLOCK 4096
+
+struct AnalyzerConfig {
+    float scalingFactor;
+    float offsetValue;
+    float tare[SENSOR_TAXELS];
+};
+
+// Distribution of durations in ns
+struct TimeHistogram {
+    std::vector<uint64_t> counts;
+    uint64_t samples;
+    uint64_t min;
+    uint64_t max;
+    double sum;
+
+    TimeHistogram() : counts(HISTOGRAM_BUCKETS, 0), samples(0), min(UINT64_MAX), max(0), sum(0.0) {}
+
+    void add(uint64_t ns);
+    void merge(const TimeHistogram& other);
+    double percentile(double fraction) const;
+    double mean() const { return samples ? sum / samples : 0.0; }
+};
+
+struct SessionStats {
+    uint64_t frames;
+    uint64_t skippedLines;
+
+    TimeHistogram interval;         // Between sample times, from the fitted clock
+
+    // Only logs with the timing columns
+    uint64_t timedFrames;
+    TimeHistogram latency;          // Sample time to arrival on the host
+    TimeHistogram arrivalInterval;  // Between arrivals, the jitter the host sees
+    uint64_t bunchedFrames;         // Arrived in the same read as the previous frame
+    uint64_t droppedSamples;
+
+    // Taxel noise is measured on frames without any contact
+    uint64_t idleFrames;
+    double idleMean[SENSOR_TAXELS];
+    double idleM2[SENSOR_TAXELS];
+
+    uint64_t saturated[SENSOR_TAXELS];
+    uint64_t saturatedFrames;
+
+    uint64_t contactFrames;
+    uint64_t levelHist[256];
+
+    SessionStats() : frames(0), skippedLines(0), timedFrames(0), bunchedFrames(0), droppedSamples(0),
+        idleFrames(0), saturatedFrames(0), contactFrames(0) {
+        memset(idleMean, 0, sizeof(idleMean));
+        memset(idleM2, 0, sizeof(idleM2));
+        memset(saturated, 0, sizeof(saturated));
+        memset(levelHist, 0, sizeof(levelHist));
+    }
+
+    void merge(const SessionStats& other);
+};
+
+static int histogramBucket(uint64_t ns)
+{
+    if (ns < HISTOGRAM_SUB_BUCKETS) return static_cast<int>(ns);
+    int exponent = 63;
+    while (!(ns >> exponent)) --exponent;
+    int shift = exponent - HISTOGRAM_SUB_BITS;
+    int sub = static_cast<int>((ns >> shift) & (HISTOGRAM_SUB_BUCKETS - 1));
+    return (shift + 1) * HISTOGRAM_SUB_BUCKETS + sub;
+}
+
+// Middle of the range of values that land in a bucket
+static double histogramBucketMid(int bucket)
+{
+    if (bucket < HISTOGRAM_SUB_BUCKETS) return bucket;
+    int shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+    uint64_t sub = bucket % HISTOGRAM_SUB_BUCKETS;
+    uint64_t start = (HISTOGRAM_SUB_BUCKETS + sub) << shift;
+    return start + ((uint64_t(1) << shift) - 1) / 2.0;
+}
+
+void TimeHistogram::add(uint64_t ns)
+{
+    ++counts[histogramBucket(ns)];
+    ++samples;
+    if (ns < min) min = ns;
+    if (ns > max) max = ns;
+    sum += ns;
+}
+
+void TimeHistogram::merge(const TimeHistogram& other)
+{
+    for (int i = 0; i < HISTOGRAM_BUCKETS; ++i) counts[i] += other.counts[i];
+    samples += other.samples;
+    if (other.min < min) min = other.min;
+    if (other.max > max) max = other.max;
+    sum += other.sum;
+}
+
+double TimeHistogram::percentile(double fraction) const
+{
+    if (samples == 0) return 0.0;
+    uint64_t target = static_cast<uint64_t>(ceil(fraction * samples));
+    if (target == 0) target = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        seen += counts[i];
+        if (seen >= target) {
+            // The bucket midpoint can fall outside what was actually seen
+            double value = histogramBucketMid(i);
+            if (value < min) value = static_cast<double>(min);
+            if (value > max) value = static_cast<double>(max);
+            return value;
+        }
+    }
+    return static_cast<double>(max);
+}
+
+void SessionStats::merge(const SessionStats& other)
+{
+    // Chan et al. pairwise update for the idle mean / variance
+    for (int i = 0; i < SENSOR_TAXELS && other.idleFrames > 0; ++i) {
+        double n = static_cast<double>(idleFrames + other.idleFrames);
+        double delta = other.idleMean[i] - idleMean[i];
+        idleMean[i] += delta * other.idleFrames / n;
+        idleM2[i] += other.idleM2[i] + delta * delta * idleFrames * other.idleFrames / n;
+    }
+    idleFrames += other.idleFrames;
+
+    frames += other.frames;
+    skippedLines += other.skippedLines;
+    interval.merge(other.interval);
+    timedFrames += other.timedFrames;
+    latency.merge(other.latency);
+    arrivalInterval.merge(other.arrivalInterval);
+    bunchedFrames += other.bunchedFrames;
+    droppedSamples += other.droppedSamples;
+    for (int i = 0; i < SENSOR_TAXELS; ++i) saturated[i] += other.saturated[i];
+    saturatedFrames += other.saturatedFrames;
+    contactFrames += other.contactFrames;
+    for (int i = 0; i < 256; ++i) levelHist[i] += other.levelHist[i];
+}
+
+// Chunk queue owned by one worker; the owner pops from the back, thieves
+// take from the front so they grab the work furthest from the owner's
+struct WorkQueue {
+    std::mutex mutex;
+    std::deque<int> chunks;
+};
+
+static bool popChunk(WorkQueue& queue, int& chunk, bool steal)
+{
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.chunks.empty()) return false;
+    if (steal) {
+        chunk = queue.chunks.front();
+        queue.chunks.pop_front();
+    }
+    else {
+        chunk = queue.chunks.back();
+        queue.chunks.pop_back();
+    }
+    return true;
+}
+
+// Read the columns from LOG_INTERVAL on as integers; ns timestamps are far
+// past what a float holds exactly
+static void parseTimingFields(const char* begin, const char* end, int64_t* out, int count)
+{
+    const char* field = begin;
+    for (int column = 0; column < LOG_INTERVAL + count; ++column) {
+        const char* tab = static_cast<const char*>(memchr(field, '\t', end - field));
+        if (column >= LOG_INTERVAL) out[column - LOG_INTERVAL] = strtoll(field, nullptr, 10);
+        if (!tab) break;
+        field = tab + 1;
+    }
+}
+
+// Per-worker replay of the live loop: contacts on every frame, the control
+// step at the GUI loop's cadence and the levels the waveform engine mixes
+struct LiveModel {
+    ContactTracker tracker;
+    WaveformEngine engine;
+    ActuatorControl control;
+    int64_t sinceControlNs;     // Sample time since the last control step
+    int64_t previousArrival;
+    bool previousClocked;       // The previous frame had a fitted sample time
+
+    LiveModel()
+        : tracker(SENSOR_GRID_SIZE, SENSOR_GRID_SIZE, CONTACT_THRESHOLD, CONTACT_MATCH_DISTANCE),
+          control(engine), sinceControlNs(0), previousArrival(-1), previousClocked(false) {}
+
+    // Contact IDs, voices and intervals restart per chunk
+    void reset()
+    {
+        tracker.reset();
+        engine.stopAll();
+        control.start();
+        sinceControlNs = static_cast<int64_t>(CONTROL_LOOP_PERIOD_MS) * 1000000;
+        previousArrival = -1;
+        previousClocked = false;
+    }
+};
+
+static void analyzeLine(const char* begin, const char* end, const AnalyzerConfig& config,
+    LiveModel& model, SessionStats& stats)
+{
+    float values[LOG_FIELDS];
+    int badFields = 0;
+    size_t numValues = parseSensorLine(begin, end, '\t', values, LOG_FIELDS, &badFields);
+    if (badFields > 0 || (numValues != LOG_FIELDS && numValues != LOG_FIELDS_UNTIMED)) {
+        ++stats.skippedLines;
+        model.previousArrival = -1;
+        model.previousClocked = false;
+        return;
+    }
+    ++stats.frames;
+
+    int64_t timing[LOG_FIELDS - LOG_INTERVAL] = {};
+    parseTimingFields(begin, end, timing, static_cast<int>(numValues) - LOG_INTERVAL);
+
+    // Until the clock locks the visualizer logs the arrival as the sample
+    // time (latency 0), and the first line has no interval. Neither is a
+    // measurement, nor is the interval from such a frame to the next.
+    int64_t latency = numValues == LOG_FIELDS ? timing[LOG_LATENCY - LOG_INTERVAL] : 1;
+    bool clocked = latency != 0;
+    if (timing[0] > 0 && clocked && model.previousClocked) {
+        stats.interval.add(static_cast<uint64_t>(timing[0]));
+    }
+    model.previousClocked = clocked;
+
+    if (numValues == LOG_FIELDS) {
+        ++stats.timedFrames;
+        int64_t arrival = timing[LOG_ARRIVAL - LOG_INTERVAL];
+        if (latency > 0) stats.latency.add(static_cast<uint64_t>(latency));
+        stats.droppedSamples += timing[LOG_DROPPED - LOG_INTERVAL];
+        if (model.previousArrival >= 0 && arrival >= model.previousArrival) {
+            stats.arrivalInterval.add(static_cast<uint64_t>(arrival - model.previousArrival));
+            if (arrival == model.previousArrival) ++stats.bunchedFrames;
+        }
+        model.previousArrival = arrival;
+    }
+
+    bool anySaturated = false;
+    for (int i = 0; i < SENSOR_TAXELS; ++i) {
+        if (values[i] >= PRESSURE_MAX) {
+            ++stats.saturated[i];
+            anySaturated = true;
+        }
+    }
+    if (anySaturated) ++stats.saturatedFrames;
+
+    // Same contact analysis, control step and voices as the live loop. The
+    // engine output is sampled once per frame rather than at its own rate.
+    int numContacts = model.tracker.update(values, config.tare);
+    int64_t intervalNs = timing[0] > 0 ? timing[0] : 0;
+    model.sinceControlNs += intervalNs;
+    if (model.sinceControlNs >= static_cast<int64_t>(CONTROL_LOOP_PERIOD_MS) * 1000000) {
+        model.control.update(model.tracker.contacts(), numContacts, config.scalingFactor, config.offsetValue);
+        model.sinceControlNs = 0;
+    }
+    uint8_t levels[FLUID_CHANNELS];
+    model.engine.render(levels, intervalNs / 1e9f);
+    ++stats.levelHist[levels[0]];
+
+    if (numContacts > 0) {
+        ++stats.contactFrames;
+        return;
+    }
+
+    ++stats.idleFrames;
+    for (int i = 0; i < SENSOR_TAXELS; ++i) {
+        double delta = values[i] - stats.idleMean[i];
+        stats.idleMean[i] += delta / stats.idleFrames;
+        stats.idleM2[i] += delta * (values[i] - stats.idleMean[i]);
+    }
+}
+
+// Process every line that starts inside [start, end). The last line may run
+// past end, the first partial line belongs to the previous chunk.
+static void analyzeChunk(std::ifstream& file, uint64_t fileSize, uint64_t start, uint64_t end,
+    std::vector<char>& buffer, const AnalyzerConfig& config, LiveModel& model, SessionStats& stats)
+{
+    uint64_t readFrom = start > 0 ? start - 1 : 0;
+    size_t length = static_cast<size_t>(end - readFrom);
+    buffer.resize(length);
+    file.clear();
+    file.seekg(static_cast<std::streamoff>(readFrom));
+    file.read(buffer.data(), length);
+
+    // Complete the last line so it is not cut in half
+    uint64_t next = end;
+    while (next < fileSize && (buffer.empty() || buffer.back() != '\n')) {
+        char block[READ_BLOCK];
+        file.read(block, sizeof(block));
+        std::streamsize got = file.gcount();
+        if (got <= 0) break;
+        const char* newline = static_cast<const char*>(memchr(block, '\n', static_cast<size_t>(got)));
+        size_t keep = newline ? static_cast<size_t>(newline - block + 1) : static_cast<size_t>(got);
+        buffer.insert(buffer.end(), block, block + keep);
+        next += keep;
+        if (newline) break;
+    }
+    buffer.push_back('\0');  // parseSensorLine needs a terminator after the last field
+
+    const char* pos = buffer.data();
+    const char* bufferEnd = buffer.data() + buffer.size() - 1;
+    if (start > 0) {
+        const char* newline = static_cast<const char*>(memchr(pos, '\n', bufferEnd - pos));
+        if (!newline) return;
+        pos = newline + 1;
+    }
+
+    // Arrival intervals across a chunk boundary are not counted
+    model.reset();
+    while (pos < bufferEnd) {
+        const char* newline = static_cast<const char*>(memchr(pos, '\n', bufferEnd - pos));
+        const char* lineEnd = newline ? newline : bufferEnd;
+        analyzeLine(pos, lineEnd, config, model, stats);
+        pos = lineEnd + 1;
+    }
+}
+
+static void workerThread(int self, std::vector<WorkQueue>* queues, const char* path, uint64_t fileSize,
+    const std::vector<uint64_t>* chunkStarts, const AnalyzerConfig* config, SessionStats* stats)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::vector<char> buffer;
+    LiveModel model;
+
+    int numWorkers = static_cast<int>(queues->size());
+    while (true) {
+        int chunk;
+        bool found = popChunk((*queues)[self], chunk, false);
+        for (int i = 1; !found && i < numWorkers; ++i) {
+            found = popChunk((*queues)[(self + i) % numWorkers], chunk, true);
+        }
+        // No chunks are added after startup, so empty queues mean we are done
+        if (!found) break;
+
+        analyzeChunk(file, fileSize, (*chunkStarts)[chunk], (*chunkStarts)[chunk + 1],
+            buffer, *config, model, *stats);
+    }
+}
+
+// The live loop tares on the first frame it receives, do the same
+static bool readTare(const char* path, float* tare)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::string line;
+    while (std::getline(file, line)) {
+        float values[LOG_FIELDS];
+        int badFields = 0;
+        size_t numValues = parseSensorLine(line.data(), line.data() + line.size(), '\t', values, LOG_FIELDS, &badFields);
+        if (badFields == 0 && (numValues == LOG_FIELDS || numValues == LOG_FIELDS_UNTIMED)) {
+            memcpy(tare, values, sizeof(float) * SENSOR_TAXELS);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void printDistribution(const char* title, const TimeHistogram& hist)
+{
+    printf("\n%s (us)\n", title);
+    if (hist.samples == 0) {
+        printf("  no samples\n");
+        return;
+    }
+    printf("  min %.1f  p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f  mean %.1f\n",
+        hist.min / 1000.0, hist.percentile(0.5) / 1000.0, hist.percentile(0.9) / 1000.0,
+        hist.percentile(0.99) / 1000.0, hist.percentile(0.999) / 1000.0, hist.max / 1000.0,
+        hist.mean() / 1000.0);
+}
+
+static void printReport(const SessionStats& stats, const AnalyzerConfig& config)
+{
+    printf("Frames: %llu (skipped lines: %llu)\n",
+        (unsigned long long)stats.frames, (unsigned long long)stats.skippedLines);
+    if (stats.frames == 0) return;
+
+    printDistribution("Sample interval", stats.interval);
+    if (stats.timedFrames > 0) {
+        printDistribution("Arrival latency", stats.latency);
+        printDistribution("Arrival interval", stats.arrivalInterval);
+        printf("  bunched frames %llu (%.2f%%)  dropped samples %llu\n", (unsigned long long)stats.bunchedFrames,
+            100.0 * stats.bunchedFrames / stats.timedFrames, (unsigned long long)stats.droppedSamples);
+    }
+
+    printf("\nTaxels (noise over %llu frames without contact)\n", (unsigned long long)stats.idleFrames);
+    printf("  taxel   tare      idle mean  idle std   saturated\n");
+    for (int i = 0; i < SENSOR_TAXELS; ++i) {
+        double stddev = stats.idleFrames > 1 ? sqrt(stats.idleM2[i] / (stats.idleFrames - 1)) : 0.0;
+        printf("  %5d   %-8.1f  %-9.1f  %-9.2f  %llu\n", i, config.tare[i], stats.idleMean[i], stddev,
+            (unsigned long long)stats.saturated[i]);
+    }
+    printf("  frames with a saturated taxel (>= %d): %llu\n", PRESSURE_MAX, (unsigned long long)stats.saturatedFrames);
+
+    // Duty cycle: share of frames the actuators are driven above the idle
+    // offset, by the mixed output (base level, texture and taps) on channel 0
+    uint64_t levelSum = 0;
+    uint64_t active = 0;
+    int idleLevel = mapForceToActuator(0.0f, config.scalingFactor, config.offsetValue);
+    for (int level = 0; level < 256; ++level) {
+        levelSum += stats.levelHist[level] * level;
+        if (level > idleLevel) active += stats.levelHist[level];
+    }
+    printf("\nActuators as streamed (scaling %.2f, offset %.0f, control every %d ms)\n",
+        config.scalingFactor, config.offsetValue, CONTROL_LOOP_PERIOD_MS);
+    printf("  contact frames %.2f%%  duty cycle %.2f%%  mean level %.1f  at max %.2f%%\n",
+        100.0 * stats.contactFrames / stats.frames, 100.0 * active / stats.frames,
+        static_cast<double>(levelSum) / stats.frames, 100.0 * stats.levelHist[PRESSURE_SCALED_MAX] / stats.frames);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <log> [--threads N] [--chunk-mb N] [--scaling F] [--offset F]\n", argv[0]);
+        return 1;
+    }
+
+    const char* path = argv[1];
+    int numWorkers = static_cast<int>(std::thread::hardware_concurrency());
+    uint64_t chunkBytes = static_cast<uint64_t>(CHUNK_MB_DEFAULT) << 20;
+    AnalyzerConfig config = {};
+    config.scalingFactor = SCALING_DEFAULT;
+    config.offsetValue = OFFSET_DEFAULT;
+
+    for (int i = 2; i < argc; i += 2) {
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", argv[i]);
+            return 1;
+        }
+        if (!strcmp(argv[i], "--threads")) numWorkers = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "--chunk-mb")) chunkBytes = static_cast<uint64_t>(atoi(argv[i + 1])) << 20;
+        else if (!strcmp(argv[i], "--scaling")) config.scalingFactor = static_cast<float>(atof(argv[i + 1]));
+        else if (!strcmp(argv[i], "--offset")) config.offsetValue = static_cast<float>(atof(argv[i + 1]));
+        else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (numWorkers < 1) numWorkers = 1;
+    if (chunkBytes == 0) chunkBytes = 1 << 20;
+
+    std::ifstream probe(path, std::ios::binary | std::ios::ate);
+    if (!probe) {
+        fprintf(stderr, "Error opening log: %s\n", path);
+        return 1;
+    }
+    uint64_t fileSize = static_cast<uint64_t>(probe.tellg());
+    probe.close();
+
+    if (!readTare(path, config.tare)) {
+        fprintf(stderr, "No frames found in %s\n", path);
+        return 1;
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    // Chunks are dealt round robin so every worker starts with local work
+    std::vector<uint64_t> chunkStarts;
+    for (uint64_t offset = 0; offset < fileSize; offset += chunkBytes) chunkStarts.push_back(offset);
+    chunkStarts.push_back(fileSize);
+    int numChunks = static_cast<int>(chunkStarts.size()) - 1;
+
+    std::vector<WorkQueue> queues(numWorkers);
+    for (int chunk = 0; chunk < numChunks; ++chunk) {
+        queues[chunk % numWorkers].chunks.push_back(chunk);
+    }
+
+    std::vector<SessionStats> workerStats(numWorkers);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < numWorkers; ++i) {
+        workers.emplace_back(workerThread, i, &queues, path, fileSize, &chunkStarts, &config, &workerStats[i]);
+    }
+    for (std::thread& worker : workers) worker.join();
+
+    SessionStats total;
+    for (const SessionStats& stats : workerStats) total.merge(stats);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    printReport(total, config);
+    printf("\nAnalyzed %.1f MB in %.2f s (%.1f MB/s, %d threads, %d chunks)\n",
+        fileSize / 1048576.0, seconds, fileSize / 1048576.0 / seconds, numWorkers, numChunks);
+    return 0;
+}
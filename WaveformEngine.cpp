@@ -0,0 +1,259 @@
+#include "WaveformEngine.h"
+
+#include <math.h>
+
+static const float PI = 3.14159265358979f;
+
+WaveformEngine::WaveformEngine()
+    : nextHandle(1), pressure(0.0f), streaming(false), sink(nullptr), rateHz(WAVE_RATE_DEFAULT)
+{
+    for (int i = 0; i < WAVE_TABLE_SIZE; ++i) {
+        sineTable[i] = sinf(2.0f * PI * i / WAVE_TABLE_SIZE);
+    }
+
+    // Texture table: fixed-seed noise, low-pass filtered and wrapped so the
+    // scan loops without a click, then normalized to -1 .. 1
+    uint32_t seed = 0x2545F491u;
+    float raw[WAVE_TABLE_SIZE];
+    for (int i = 0; i < WAVE_TABLE_SIZE; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        raw[i] = (seed >> 8) / 8388608.0f - 1.0f;
+    }
+    float peak = 0.0f;
+    for (int i = 0; i < WAVE_TABLE_SIZE; ++i) {
+        float sum = 0.0f;
+        for (int k = -4; k <= 4; ++k) sum += raw[(i + k + WAVE_TABLE_SIZE) % WAVE_TABLE_SIZE];
+        noiseTable[i] = sum / 9.0f;
+        peak = fmaxf(peak, fabsf(noiseTable[i]));
+    }
+    for (int i = 0; i < WAVE_TABLE_SIZE; ++i) noiseTable[i] /= peak;
+
+    for (Voice& voice : voices) voice.active = false;
+    for (std::atomic<uint8_t>& level : baseLevels) level = 0;
+    resetStats();
+}
+
+WaveformEngine::~WaveformEngine()
+{
+    stop();
+}
+
+void WaveformEngine::start(WaveSink newSink, float newRateHz)
+{
+    stop();
+    sink = newSink;
+    rateHz = newRateHz;
+    resetStats();
+    streaming = true;
+    thread = std::thread(&WaveformEngine::streamThread, this);
+}
+
+void WaveformEngine::stop()
+{
+    streaming = false;
+    if (thread.joinable()) thread.join();
+}
+
+void WaveformEngine::setBaseLevels(const uint8_t levels[FLUID_CHANNELS])
+{
+    for (int ch = 0; ch < FLUID_CHANNELS; ++ch) baseLevels[ch] = levels[ch];
+}
+
+void WaveformEngine::setPressure(float newPressure)
+{
+    pressure = fminf(fmaxf(newPressure, 0.0f), 1.0f);
+}
+
+int WaveformEngine::play(const WavePattern& pattern)
+{
+    std::lock_guard<std::mutex> lock(voiceMutex);
+    for (Voice& voice : voices) {
+        if (voice.active) continue;
+        voice.active = true;
+        voice.released = false;
+        voice.handle = nextHandle++;
+        voice.pattern = pattern;
+        voice.phase = 0.0f;
+        voice.time = 0.0f;
+        voice.releaseTime = 0.0f;
+        voice.releaseLevel = 0.0f;
+        return voice.handle;
+    }
+    return -1;
+}
+
+void WaveformEngine::release(int handle)
+{
+    std::lock_guard<std::mutex> lock(voiceMutex);
+    for (Voice& voice : voices) {
+        if (voice.active && !voice.released && voice.handle == handle) {
+            voice.releaseLevel = envelopeLevel(voice);
+            voice.released = true;
+            voice.releaseTime = 0.0f;
+        }
+    }
+}
+
+void WaveformEngine::stopAll()
+{
+    std::lock_guard<std::mutex> lock(voiceMutex);
+    for (Voice& voice : voices) voice.active = false;
+}
+
+float WaveformEngine::envelopeLevel(const Voice& voice) const
+{
+    const WaveEnvelope& env = voice.pattern.envelope;
+    if (voice.released) {
+        if (env.release <= 0.0f) return 0.0f;
+        return voice.releaseLevel * fmaxf(1.0f - voice.releaseTime / env.release, 0.0f);
+    }
+
+    float t = voice.time;
+    if (t < env.attack) return t / env.attack;
+    t -= env.attack;
+    if (t < env.decay) return 1.0f - (1.0f - env.sustain) * t / env.decay;
+    return env.sustain;
+}
+
+void WaveformEngine::render(uint8_t levels[FLUID_CHANNELS], float dt)
+{
+    float mix[FLUID_CHANNELS];
+    for (int ch = 0; ch < FLUID_CHANNELS; ++ch) mix[ch] = baseLevels[ch];
+    float currentPressure = pressure;
+
+    {
+        std::lock_guard<std::mutex> lock(voiceMutex);
+        for (Voice& voice : voices) {
+            if (!voice.active) continue;
+            const WavePattern& pattern = voice.pattern;
+
+            if (voice.released && voice.releaseTime >= pattern.envelope.release) {
+                voice.active = false;
+                continue;
+            }
+
+            int index = static_cast<int>(voice.phase * WAVE_TABLE_SIZE) & (WAVE_TABLE_SIZE - 1);
+            float frequency = pattern.frequency;
+            float wave = 1.0f;
+            switch (pattern.shape) {
+            case WAVE_CONSTANT:
+                break;
+            case WAVE_SINE:
+                wave = 0.5f + 0.5f * sineTable[index];
+                break;
+            case WAVE_PULSE:
+                wave = voice.phase < pattern.dutyCycle ? 1.0f : 0.0f;
+                break;
+            case WAVE_TEXTURE:
+                wave = (0.5f + 0.5f * noiseTable[index]) * currentPressure;
+                frequency *= currentPressure;
+                break;
+            }
+
+            float env = envelopeLevel(voice);
+            float value = pattern.amplitude * env * wave;
+            for (int ch = 0; ch < FLUID_CHANNELS; ++ch) {
+                if (pattern.channelMask & (1 << ch)) mix[ch] += value;
+            }
+
+            voice.phase += frequency * dt;
+            voice.phase -= floorf(voice.phase);
+            voice.time += dt;
+            if (voice.released) {
+                voice.releaseTime += dt;
+            }
+            else if (pattern.duration > 0.0f && voice.time >= pattern.duration) {
+                voice.releaseLevel = env;
+                voice.released = true;
+                voice.releaseTime = 0.0f;
+            }
+        }
+    }
+
+    for (int ch = 0; ch < FLUID_CHANNELS; ++ch) {
+        levels[ch] = static_cast<uint8_t>(fminf(fmaxf(mix[ch] + 0.5f, 0.0f), 255.0f));
+    }
+}
+
+void WaveformEngine::streamThread()
+{
+    typedef std::chrono::steady_clock Clock;
+    const Clock::duration period = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / rateHz));
+    const float dt = 1.0f / rateHz;
+
+    // Sleeping wakes up late by a platform dependent amount, so the spin
+    // margin follows the worst recent overshoot, capped so the thread mostly
+    // sleeps even where the timer is coarse
+    const double maxMarginUs = 1e6 / rateHz * WAVE_SPIN_MAX_FRACTION;
+    double overshootUs = maxMarginUs;
+
+    uint8_t levels[FLUID_CHANNELS];
+    Clock::time_point deadline = Clock::now() + period;
+
+    while (streaming) {
+        // Render ahead, then sleep most of the way and spin onto the deadline
+        render(levels, dt);
+        double marginUs = fmin(overshootUs + WAVE_SPIN_GUARD_US, maxMarginUs);
+        Clock::time_point spinFrom = deadline - std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double, std::micro>(marginUs));
+        overshootUs *= WAVE_OVERSHOOT_DECAY;
+        if (Clock::now() < spinFrom) {
+            std::this_thread::sleep_until(spinFrom);
+            double wokeLateUs = std::chrono::duration<double, std::micro>(Clock::now() - spinFrom).count();
+            overshootUs = fmax(overshootUs, wokeLateUs);
+        }
+        while (Clock::now() < deadline) std::this_thread::yield();
+
+        Clock::time_point sent = Clock::now();
+        sink(levels);
+
+        double lateUs = std::chrono::duration<double, std::micro>(sent - deadline).count();
+        deadline += period;
+        bool missed = sent >= deadline;
+        if (missed) {
+            // Fell a full period behind, skip ahead rather than bursting to catch up
+            deadline = sent + period;
+        }
+
+        std::lock_guard<std::mutex> lock(statsMutex);
+        ++statUpdates;
+        if (missed) ++statMissed;
+        statJitterSum += lateUs;
+        statJitterSqSum += lateUs * lateUs;
+        if (lateUs > statJitterMax) statJitterMax = lateUs;
+        statSpinMargin = marginUs;
+        statLastSend = sent;
+    }
+}
+
+WaveEngineStats WaveformEngine::stats() const
+{
+    std::lock_guard<std::mutex> lock(statsMutex);
+    WaveEngineStats result = {};
+    result.updates = statUpdates;
+    result.missedDeadlines = statMissed;
+    if (statUpdates == 0) return result;
+
+    double mean = statJitterSum / statUpdates;
+    double elapsed = std::chrono::duration<double>(statLastSend - statStart).count();
+    result.rateHz = elapsed > 0.0 ? statUpdates / elapsed : 0.0;
+    result.jitterMeanUs = mean;
+    result.jitterStdUs = sqrt(fmax(statJitterSqSum / statUpdates - mean * mean, 0.0));
+    result.jitterMaxUs = statJitterMax;
+    result.spinMarginUs = statSpinMargin;
+    return result;
+}
+
+void WaveformEngine::resetStats()
+{
+    std::lock_guard<std::mutex> lock(statsMutex);
+    statUpdates = 0;
+    statMissed = 0;
+    statJitterSum = 0.0;
+    statJitterSqSum = 0.0;
+    statJitterMax = 0.0;
+    statSpinMargin = 0.0;
+    statStart = std::chrono::steady_clock::now();
+    statLastSend = statStart;
+}
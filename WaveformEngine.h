@@ -0,0 +1,122 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include "FluidProtocol.h"
+
+#define WAVE_TABLE_SIZE 1024
+#define WAVE_MAX_VOICES 16
+#define WAVE_RATE_DEFAULT 500.0f      // Updates per second sent to the driver
+#define WAVE_SPIN_GUARD_US 100        // Busy-wait margin on top of the measured sleep overshoot
+#define WAVE_SPIN_MAX_FRACTION 0.25f  // Never busy-wait for more than this share of a period
+#define WAVE_OVERSHOOT_DECAY 0.999f   // Per update, lets the overshoot estimate recover from outliers
+
+enum WaveShape {
+    WAVE_CONSTANT,
+    WAVE_SINE,
+    WAVE_PULSE,
+    WAVE_TEXTURE,   // Noise scanned faster and played louder with more pressure
+};
+
+// ADSR envelope, times in seconds, sustain as a fraction of the amplitude
+struct WaveEnvelope {
+    float attack;
+    float decay;
+    float sustain;
+    float release;
+};
+
+struct WavePattern {
+    WaveShape shape;
+    uint8_t channelMask;    // Bit per channel the pattern plays on
+    float amplitude;        // Level added at full envelope, 0 - 255
+    float frequency;        // Hz; for textures the scan rate at full pressure
+    float dutyCycle;        // Pulse trains only, 0 - 1
+    float duration;         // Seconds until release starts, <= 0 to hold until released
+    WaveEnvelope envelope;
+};
+
+struct WaveEngineStats {
+    uint64_t updates;
+    uint64_t missedDeadlines;   // Updates sent a full period or more late
+    double rateHz;              // Achieved update rate
+    double jitterMeanUs;        // Send time relative to the deadline
+    double jitterStdUs;
+    double jitterMaxUs;
+    double spinMarginUs;        // Current busy-wait margin before each deadline
+};
+
+typedef int (*WaveSink)(const uint8_t levels[FLUID_CHANNELS]);
+
+// Synthesizes per-channel vibration levels from a fixed pool of voices and
+// streams them to a sink at a fixed rate. Voices are mixed on top of the
+// base levels set by the control loop; nothing is allocated once running.
+class WaveformEngine {
+public:
+    WaveformEngine();
+    ~WaveformEngine();
+
+    void start(WaveSink sink, float rateHz = WAVE_RATE_DEFAULT);
+    void stop();
+
+    // Static level per channel, what setFluidValues used to send
+    void setBaseLevels(const uint8_t levels[FLUID_CHANNELS]);
+
+    // Normalized contact pressure (0 - 1) that drives texture voices
+    void setPressure(float pressure);
+
+    // Returns a handle for release(), or -1 when all voices are busy
+    int play(const WavePattern& pattern);
+    void release(int handle);
+    void stopAll();
+
+    // Render the next update into levels and advance time by dt seconds.
+    // Called by the streaming thread; exposed for offline rendering.
+    void render(uint8_t levels[FLUID_CHANNELS], float dt);
+
+    WaveEngineStats stats() const;
+    void resetStats();
+
+private:
+    struct Voice {
+        bool active;
+        bool released;
+        int handle;
+        WavePattern pattern;
+        float phase;            // Position in the table, 0 - 1
+        float time;             // Seconds since the voice started
+        float releaseTime;      // Seconds since release started
+        float releaseLevel;     // Envelope level when release started
+    };
+
+    float envelopeLevel(const Voice& voice) const;
+    void streamThread();
+
+    float sineTable[WAVE_TABLE_SIZE];
+    float noiseTable[WAVE_TABLE_SIZE];
+
+    mutable std::mutex voiceMutex;
+    Voice voices[WAVE_MAX_VOICES];
+    int nextHandle;
+    std::atomic<uint8_t> baseLevels[FLUID_CHANNELS];
+    std::atomic<float> pressure;
+
+    std::thread thread;
+    std::atomic<bool> streaming;
+    WaveSink sink;
+    float rateHz;
+
+    mutable std::mutex statsMutex;
+    uint64_t statUpdates;
+    uint64_t statMissed;
+    double statJitterSum;
+    double statJitterSqSum;
+    double statJitterMax;
+    double statSpinMargin;
+    std::chrono::steady_clock::time_point statStart;
+    std::chrono::steady_clock::time_point statLastSend;
+};
@@ -9,28 +9,39 @@
 #include <chrono>
 #include <algorithm> 
 #include <commctrl.h>
+#include <timeapi.h>
 
 #include "FluidReality.h"
+#include "ContactTracker.h"
+#include "SensorPipeline.h"
+#include "SensorClock.h"
+#include "WaveformEngine.h"
+#include "ActuatorControl.h"
 
-#define GRID_SIZE 4
+#define GRID_SIZE SENSOR_GRID_SIZE
 #define CELL_SIZE 100
-#define PRESSURE_MIN 0
-#define PRESSURE_MAX 6500
-#define PRESSURE_SCALED_MIN 0
-#define PRESSURE_SCALED_MAX 255
-
-// Custom clamp function
-template <typename T>
-T clamp(T value, T minValue, T maxValue) {
-    return (value < minValue) ? minValue : (value > maxValue) ? maxValue : value;
-}
+#define PRINT_QUEUE_MAX 4096    // Frames buffered for the log before they are dropped
+
+struct LoggedFrame {
+    float values[SENSOR_TAXELS];
+    FrameTiming timing;
+};
 
-float scalingStart(1.5f);
-float offsetStart(120.0f);
+float scalingStart(SCALING_DEFAULT);
+float offsetStart(OFFSET_DEFAULT);
 
 std::mutex frameMutex;
 std::vector<float> latestFrame(16, 0.0f);
 std::vector<float> tareValues(16, 0.0f);
+ContactTracker contactTracker(GRID_SIZE, GRID_SIZE, CONTACT_THRESHOLD, CONTACT_MATCH_DISTANCE);
+std::vector<Contact> latestContacts;
+SensorClock sensorClock;
+std::mutex printMutex;
+std::vector<LoggedFrame> printQueue;
+uint64_t unloggedFrames = 0;
+WaveformEngine waveformEngine;
+ActuatorControl actuatorControl(waveformEngine);
+std::atomic<bool> actuatorsActive(false);
 std::atomic<bool> running(true);
 std::atomic<bool> christina(true);
 std::atomic<bool> hasTare(false);
@@ -51,10 +62,7 @@ void AttachConsoleWindow() {
 }
 
 COLORREF GetPressureColor(float pressure, float tare) {
-    float adjustedPressure = pressure - tare;
-    adjustedPressure = clamp(adjustedPressure, (float)PRESSURE_MIN, (float)PRESSURE_MAX);
-    float normalized = (adjustedPressure - PRESSURE_MIN) / (PRESSURE_MAX - PRESSURE_MIN);
-    int red = static_cast<int>(normalized * 255);
+    int red = pressureColorLevel(pressure, tare);
     int blue = 255 - red;
     return RGB(red, 0, blue);
 }
@@ -82,30 +90,20 @@ COLORREF GetActuatorColor(float actuatorValue, float offset) {
 
 
 
-uint8_t mapPressureToActuator(float pressureValue) {
-
-    float averageTare = 0.0f;
-    {
-        for (float val : tareValues) averageTare += val;
-        averageTare /= tareValues.size();
-    }
-
-    // Apply scaling to increase responsiveness
-    double scaledValue = ((pressureValue-averageTare) / 6500.0) * 254 * scalingFactor;
-
-    // Map to actuator range, ensuring it doesn't exceed ACTUATOR_MAX
-    uint8_t actuatorValue = static_cast<uint8_t>(clamp(scaledValue + offsetValue,
-        static_cast<double>(PRESSURE_SCALED_MIN),
-        static_cast<double>(PRESSURE_SCALED_MAX)));
-
-    return actuatorValue;
+// Undo everything StartActuators did; safe to call from every exit path
+void StopActuators() {
+    if (!actuatorsActive.exchange(false)) return;
+    actuatorControl.stop();
+    waveformEngine.stop();
+    timeEndPeriod(1);
+    DisablePSU();
+    exitFluidReality();
 }
 
 void OnWindowClose() {
     std::cout << "Window is closing! Cleaning up..." << std::endl;
     // Add any cleanup code here
-    DisablePSU();
-    exitFluidReality();
+    StopActuators();
 }
 
 LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
@@ -126,6 +124,25 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             }
         }
 
+        // Mark each tracked contact at its centroid
+        SetBkMode(hdc, TRANSPARENT);
+        SetTextColor(hdc, RGB(255, 255, 255));
+        for (const Contact& contact : latestContacts) {
+            int cx = static_cast<int>((GRID_SIZE - 1 - contact.centroidX + 0.5f) * CELL_SIZE); // Flip left-to-right
+            int cy = static_cast<int>((contact.centroidY + 0.5f) * CELL_SIZE);
+            HBRUSH contactBrush = CreateSolidBrush(RGB(255, 255, 255));
+            HGDIOBJ oldBrush = SelectObject(hdc, contactBrush);
+            Ellipse(hdc, cx - 6, cy - 6, cx + 6, cy + 6);
+            SelectObject(hdc, oldBrush);
+            DeleteObject(contactBrush);
+
+            wchar_t idText[16];
+            swprintf(idText, 16, L"#%d", contact.id);
+            TextOut(hdc, cx + 8, cy - 8, idText, wcslen(idText));
+        }
+        SetBkMode(hdc, OPAQUE);
+        SetTextColor(hdc, RGB(0, 0, 0));
+
         // Display latest actuation value
         wchar_t buffer[50];
         swprintf(buffer, 50, L"Actuation: %.2f", latestActuationValue.load());
@@ -141,6 +158,13 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
         FillRect(hdc, &actuatorRect, actuatorBrush);
         DeleteObject(actuatorBrush);
 
+        // Update rate and jitter the waveform engine actually achieves
+        WaveEngineStats waveStats = waveformEngine.stats();
+        wchar_t waveText[80];
+        swprintf(waveText, 80, L"Waveform: %.0f Hz, jitter %.0f us (max %.0f)",
+            waveStats.rateHz, waveStats.jitterStdUs, waveStats.jitterMaxUs);
+        TextOut(hdc, 10, GRID_SIZE * CELL_SIZE + 110, waveText, wcslen(waveText));
+
         EndPaint(hwnd, &ps);
         return 0;
     }
@@ -231,6 +255,9 @@ void SerialReaderThread(const std::wstring& portName, int baudRate) {
 
     while (running) {
         if (ReadFile(hSerial, buffer, bufferSize - 1, &bytesRead, nullptr) && bytesRead > 0) {
+            // Every frame completed by this read shares its arrival time
+            int64_t arrivalNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
             buffer[bytesRead] = '\0';  // Null-terminate buffer
             lineBuffer += buffer;
 
@@ -241,44 +268,55 @@ void SerialReaderThread(const std::wstring& portName, int baudRate) {
                 std::string line = lineBuffer.substr(0, newlinePos);
                 lineBuffer.erase(0, newlinePos + 1);  // Remove processed line
 
-                std::vector<float> values;
-                std::stringstream ss(line);
-                std::string token;
-
                 //printf("r:%s\n\n", line.c_str());
 
-                size_t start = 0, end = 0;
-                // Fast CSV parsing (manual split instead of stringstream)
-                while ((end = line.find(',', start)) != std::string::npos) {
-                    try {
-                        values.push_back(std::stof(line.substr(start, end - start)));
-                    }
-                    catch (...) {
-                        std::cerr << "Error converting value: " << line.substr(start, end - start) << std::endl;
-                    }
-                    start = end + 1;
+                float values[SENSOR_TAXELS + 1];
+                int badFields = 0;
+                size_t numValues = parseSensorLine(line.data(), line.data() + line.size(), ',',
+                    values, SENSOR_TAXELS + 1, &badFields);
+                if (badFields > 0) {
+                    // Never guess which taxel a value belongs to
+                    std::cerr << "Error converting " << badFields << " value(s), frame dropped: " << line << std::endl;
                 }
+                // Expecting 16 floats, optionally followed by a device sample counter
+                else if (numValues == SENSOR_TAXELS || numValues == SENSOR_TAXELS + 1) {
+                    int64_t deviceCounter = -1;
+                    if (numValues == SENSOR_TAXELS + 1) {
+                        deviceCounter = parseSensorCounter(line.data(), line.data() + line.size(), ',');
+                    }
+                    // Drops are reported by the print thread, console writes here
+                    // would stall the reads the clock is timing
+                    FrameTiming timing = sensorClock.addFrame(arrivalNs, deviceCounter);
 
-                // Last value (after the final comma)
-                try {
-                    values.push_back(std::stof(line.substr(start)));
-                }
-                catch (...) {
-                    std::cerr << "Error converting last value: " << line.substr(start) << std::endl;
-                }
+                    {
+                        // Every frame is logged, not just the latest one
+                        std::lock_guard<std::mutex> lock(printMutex);
+                        if (printQueue.size() < PRINT_QUEUE_MAX) {
+                            LoggedFrame logged;
+                            std::copy(values, values + SENSOR_TAXELS, logged.values);
+                            logged.timing = timing;
+                            printQueue.push_back(logged);
+                        }
+                        else {
+                            ++unloggedFrames;
+                        }
+                        christina = true;
+                    }
 
-                if (values.size() == 16) {  // Expecting exactly 16 floats
                     std::lock_guard<std::mutex> lock(frameMutex);
-                    latestFrame = values;
-                    christina = true;
+                    latestFrame.assign(values, values + SENSOR_TAXELS);
                     if (!hasTare)
                     {
-                        tareValues = values;
+                        tareValues = latestFrame;
                         hasTare = true;
                     }
+
+                    // Contact analysis runs on every frame, storage is preallocated
+                    int numContacts = contactTracker.update(latestFrame.data(), tareValues.data());
+                    latestContacts.assign(contactTracker.contacts(), contactTracker.contacts() + numContacts);
                 }
                 else {
-                    std::cerr << "Warning: Received " << values.size() << " floats instead of 16!" << std::endl;
+                    std::cerr << "Warning: Received " << numValues << " floats instead of 16 (or 16 and a counter)!" << std::endl;
                 }
             }
         }
@@ -290,28 +328,55 @@ void SerialReaderThread(const std::wstring& portName, int baudRate) {
 
 void PrintThread() {
     AttachConsoleWindow();
-    auto prevTime = std::chrono::steady_clock::now();
+    std::vector<LoggedFrame> frames;
+    frames.reserve(PRINT_QUEUE_MAX);
+    int64_t prevSampleNs = 0;
 
     while (running) {
         if (christina)
         {
-            std::lock_guard<std::mutex> lock(frameMutex);
-            if (!latestFrame.empty()) {
-                auto timeNow = std::chrono::steady_clock::now();
-                auto elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(timeNow - prevTime).count();
-                prevTime = timeNow;
+            uint64_t unlogged;
+            {
+                std::lock_guard<std::mutex> lock(printMutex);
+                frames.swap(printQueue);
+                unlogged = unloggedFrames;
+                unloggedFrames = 0;
+                christina = false;
+            }
+            if (unlogged > 0) {
+                std::cerr << "Warning: " << unlogged << " frame(s) not logged, console too slow" << std::endl;
+            }
 
-                for (float f : latestFrame)
-                    std::cout << f << "\t";
-                std::cout << elapsedNs << std::endl;
+            // Taxels, then the time between the samples themselves, when the
+            // frame arrived, arrival minus sample time, sample index and drops
+            int64_t dropped = 0;
+            int64_t lastDropIndex = 0;
+            for (const LoggedFrame& frame : frames) {
+                const FrameTiming& timing = frame.timing;
+                if (timing.dropped > 0) {
+                    dropped += timing.dropped;
+                    lastDropIndex = timing.sampleIndex;
+                }
+                int64_t elapsedNs = prevSampleNs ? timing.sampleNs - prevSampleNs : 0;
+                prevSampleNs = timing.sampleNs;
 
+                for (float f : frame.values)
+                    std::cout << f << "\t";
+                std::cout << elapsedNs << "\t" << timing.arrivalNs << "\t" << timing.arrivalNs - timing.sampleNs
+                    << "\t" << timing.sampleIndex << "\t" << timing.dropped << "\n";
+            }
+            std::cout.flush();
+            if (dropped > 0) {
+                std::cerr << "Warning: " << dropped << " frame(s) dropped, the last before sample "
+                    << lastDropIndex << std::endl;
             }
-            christina = false;
+            frames.clear();
         }
         std::this_thread::sleep_for(std::chrono::microseconds(1));  // Allow the reader thread to work
     }
 }
 
+
 void GUIThread() {
     WNDCLASS wc = {};
     wc.lpfnWndProc = WindowProc;
@@ -368,33 +433,15 @@ void GUIThread() {
             DispatchMessage(&msg);
         }
 
-        float average = 0.0f;
+        // The waveform engine streams the resulting levels and patterns
         {
             std::lock_guard<std::mutex> lock(frameMutex);
-
-            if (latestFrame.size() >= 5) {  // Ensure there are at least 5 values
-                std::vector<float> tempFrame = latestFrame;  // Copy the frame
-                std::partial_sort(tempFrame.begin(), tempFrame.begin() + 5, tempFrame.end(), std::greater<float>());
-
-                // Compute the average of the top 5
-                float sum = 0.0f;
-                for (int i = 0; i < 5; ++i) {
-                    sum += tempFrame[i];
-                }
-                average = sum / 5.0f;
-            }
+            latestActuationValue = actuatorControl.update(latestContacts.data(),
+                static_cast<int>(latestContacts.size()), scalingFactor, offsetValue);
         }
 
-        char values[8];
-        char scaledChar = mapPressureToActuator(average);
-        for (char& val : values) {
-            val = scaledChar;
-        }
-        setFluidValues(values);
-        latestActuationValue = static_cast<unsigned char>(scaledChar);
-
         InvalidateRect(hwnd, nullptr, FALSE);
-        Sleep(100);
+        Sleep(CONTROL_LOOP_PERIOD_MS);
     }
 }
 
@@ -402,8 +449,11 @@ void GUIThread() {
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nCmdShow) {
     AttachConsoleWindow();
 
-    initFluidReality();
-    EnablePSU();
+    // Without the driver the visualizer still runs, sensor only
+    bool fluidConnected = initFluidReality() == 0;
+    if (!fluidConnected) {
+        wprintf(L"Fluid Haptics driver could not be opened, running without actuators.\n");
+    }
 
     wchar_t comPort[64] = L""; // Buffer to store the COM port
     char vid[] = "VID_2886";
@@ -416,10 +466,24 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
     else
     {
         wprintf(L"No matching COM port for Touchlab found.\n");
+        if (fluidConnected) exitFluidReality();
         return -1;
     }
     int baudRate = 115200;
 
+    // Both devices are there, start streaming to the driver.
+    // 1 ms timer resolution so the waveform engine can sleep close to its deadlines
+    if (fluidConnected) {
+        EnablePSU();
+        timeBeginPeriod(1);
+        waveformEngine.start(sendFluidFrame);
+        actuatorControl.start();
+        actuatorsActive = true;
+    }
+
+    latestContacts.reserve(CONTACT_MAX_DEFAULT);
+    printQueue.reserve(PRINT_QUEUE_MAX);
+
     
     std::thread guiThread(GUIThread);
     std::thread readerThread(SerialReaderThread, comPort, baudRate);
@@ -434,8 +498,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
     printerThread.join();
     readerThread.join();
 
-    DisablePSU();
-    exitFluidReality();
+    StopActuators();
 
     return 0;
 }